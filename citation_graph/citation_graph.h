@@ -3,8 +3,20 @@
 
 #include <vector>
 #include <memory>
-#include <map>
-#include <set>
+#include <string>
+#include <string_view>
+#include <functional>
+#include <unordered_map>
+#include <optional>
+#include <algorithm>
+#include <type_traits>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <atomic>
+#include <thread>
+#include <iterator>
+#include <cstddef>
 
 class PublicationNotFound : public std::exception {
     const char* what() const noexcept override {
@@ -24,111 +36,791 @@ class TriedToRemoveRoot : public std::exception {
     }
 };
 
+class CitationCycle : public std::exception {
+    const char* what() const noexcept override {
+        return "CitationCycle";
+    }
+};
+
+/// Typ, którym szukamy publikacji po id. Napis można znaleźć na podstawie widoku na niego,
+/// bez tworzenia obiektu id_type.
+template <class Id> struct IdLookup {
+    using type = Id const &;
+};
+
+template <class Char, class Traits, class Allocator> struct IdLookup<std::basic_string<Char, Traits, Allocator>> {
+    using type = std::basic_string_view<Char, Traits>;
+};
+
 template <class Publication> class CitationGraph {
+public:
+    // Kierunek przechodzenia grafu: do publikacji cytujących (dzieci) albo cytowanych (rodziców).
+    enum class Direction {
+        children,
+        parents
+    };
+
+    // Pamięć zajmowana przez graf w bajtach, zwracana przez memory_stats.
+    struct MemoryStats {
+        size_t nodes;   // Arena węzłów bez publikacji: listy sąsiadów trzymane w węźle, wolne sloty.
+        size_t edges;   // Listy sąsiadów, które nie zmieściły się w węźle.
+        size_t index;   // Tablica haszująca id -> węzeł.
+        size_t payload; // Obiekty Publication razem z kopią id (bez pamięci zaalokowanej przez nie same).
+
+        size_t total() const noexcept {
+            return nodes + edges + index + payload;
+        }
+    };
+
 private:
-    class Node : public std::enable_shared_from_this<Node> {
+    using id_type = typename Publication::id_type;
+    using lookup_type = typename IdLookup<id_type>::type;
+
+    // Węzły są numerowane gęsto od 0, numer jest pozycją węzła w arenie.
+    using node_index = uint32_t;
+    static constexpr node_index NO_NODE = UINT32_MAX;
+
+    /**
+     * Wektor, który pierwsze N elementów trzyma wewnątrz obiektu - większość publikacji ma niewielu
+     * sąsiadów, więc zwykle nie potrzeba żadnej alokacji. Tylko dla typów trywialnie kopiowalnych.
+     */
+    template <class T, uint32_t N> class SmallVector {
+        static_assert(std::is_trivially_copyable_v<T>);
+
     private:
-        // owner_less używa owner_before - nigdy nie rzuca wyjątku
-        Publication publication;
-        std::map<typename Publication::id_type, std::weak_ptr<Node>> *publications_map_ptr;
-        typename std::map<typename Publication::id_type, std::weak_ptr<Node>>::iterator iterator_in_map;
-        std::set<std::weak_ptr<Node>, std::owner_less<std::weak_ptr<Node>>> parents;
-        std::set<std::shared_ptr<Node>> children;
+        uint32_t count = 0;
+        uint32_t capacity = N;
+        union {
+            T local[N];
+            T *heap;
+        };
+
+        bool is_local() const noexcept {
+            return capacity == N;
+        }
 
     public:
-        void set_iterator(typename std::map<typename Publication::id_type, std::weak_ptr<Node>>::iterator &it) {
-            this->iterator_in_map = std::move(it);
+        SmallVector() noexcept {}
+
+        SmallVector(const SmallVector &) = delete;
+        SmallVector& operator=(const SmallVector &) = delete;
+
+        ~SmallVector() {
+            if (!is_local())
+                delete[] heap;
+        }
+
+        T* begin() noexcept {
+            return is_local() ? local : heap;
         }
 
-        /// Może rzucić - strong guarantee
-        void add_parent(const std::weak_ptr<Node> &new_parent) {
-            parents.insert(std::weak_ptr(new_parent));
+        const T* begin() const noexcept {
+            return is_local() ? local : heap;
+        }
+
+        T* end() noexcept {
+            return begin() + count;
+        }
+
+        const T* end() const noexcept {
+            return begin() + count;
+        }
+
+        uint32_t size() const noexcept {
+            return count;
+        }
+
+        bool empty() const noexcept {
+            return count == 0;
+        }
+
+        T& operator[](uint32_t i) noexcept {
+            return begin()[i];
+        }
+
+        const T& operator[](uint32_t i) const noexcept {
+            return begin()[i];
+        }
+
+        T& back() noexcept {
+            return begin()[count - 1];
+        }
+
+        /// Pamięć zaalokowana poza obiektem
+        size_t heap_bytes() const noexcept {
+            return is_local() ? 0 : capacity * sizeof(T);
         }
 
         /// Może rzucić wyjątek - strong guarantee
-        void add_child(const std::shared_ptr<Node> &new_child) {
-            children.insert(std::shared_ptr(new_child));
+        void reserve(uint32_t new_capacity) {
+            if (new_capacity <= capacity)
+                return;
+
+            new_capacity = std::max(new_capacity, 2 * capacity);
+            T *items = new T[new_capacity];
+            std::memcpy(items, begin(), count * sizeof(T));
+            if (!is_local())
+                delete[] heap;
+            heap = items;
+            capacity = new_capacity;
         }
 
-        /// Nie rzuca wyjątku
-        Publication& get_publication() noexcept {
-            return this->publication;
+        /// Może rzucić wyjątek - strong guarantee. Nie rzuca, jeśli wcześniej zarezerwowano miejsce.
+        void push_back(const T &item) {
+            reserve(count + 1);
+            begin()[count++] = item;
         }
 
-        /// Nie rzuca wyjątku, bo porównanie shared_ptr nie rzuca wyjątku
-        void erase_child(const std::shared_ptr<Node> &to_delete) noexcept {
-            children.erase(to_delete);
+        void pop_back() noexcept {
+            count--;
         }
 
-        /// Nie rzuca wyjątku, bo porównanie weak_ptr nie rzuca wyjątku
-        void erase_parent(const std::weak_ptr<Node> &to_delete) noexcept {
-            parents.erase(to_delete);
+        /// Zwalnia pamięć, nie rzuca wyjątku
+        void clear() noexcept {
+            if (!is_local())
+                delete[] heap;
+            count = 0;
+            capacity = N;
         }
+    };
 
-        /// Nie rzuca wyjątku, bo erase_child nie rzuca wyjątku
-        void erase_from_parents() noexcept {
-            std::shared_ptr<Node> this_shared_ptr = this->shared_from_this();
+    // Krawędź na liście sąsiadów: sąsiad i pozycja krawędzi odwrotnej na jego liście.
+    // Dzięki temu krawędź usuwamy w czasie stałym, bez szukania.
+    struct Edge {
+        node_index node;
+        uint32_t back;
+    };
+
+    using Adjacency = SmallVector<Edge, 2>;
 
-            for (auto &parent : parents)
-                parent.lock()->erase_child(this_shared_ptr);
+    struct Record {
+        id_type id; // Klucz indeksu - porównując id nie musimy wołać Publication::get_id.
+        Publication publication;
+
+        explicit Record(id_type const &id) : id(id), publication(id) {}
+    };
+
+    struct Node {
+        std::optional<Record> record; // Pusty dla wolnego slotu.
+        Adjacency children;
+        Adjacency parents;
+        uint64_t creation_order = 0;   // Krawędzie z create zawsze prowadzą do publikacji utworzonej później.
+        uint32_t hash_tag = 0;
+        node_index next_free = NO_NODE; // Dla żywego węzła - następny na liście węzłów do zwolnienia.
+    };
+
+    /**
+     * Arena węzłów: bloki o stałym rozmiarze, więc węzły (i referencje do publikacji) nie zmieniają
+     * położenia. Zwolnione sloty trafiają na listę wolnych i są używane ponownie.
+     */
+    class NodeArena {
+    private:
+        static constexpr uint32_t BLOCK_BITS = 12;
+        static constexpr uint32_t BLOCK_SIZE = 1u << BLOCK_BITS;
+
+        std::vector<std::unique_ptr<Node[]>> blocks;
+        node_index cnt_slots = 0;
+        node_index cnt_free = 0;
+        node_index first_free = NO_NODE;
+
+    public:
+        Node& operator[](node_index i) noexcept {
+            return blocks[i >> BLOCK_BITS][i & (BLOCK_SIZE - 1)];
         }
 
-        explicit Node(typename Publication::id_type const &id,
-                std::shared_ptr<std::map<typename Publication::id_type, std::weak_ptr<Node>>> const &pub_map) :
-                publication(Publication(id)),
-                publications_map_ptr(pub_map.get()),
-                iterator_in_map((*pub_map).end()) {}
+        const Node& operator[](node_index i) const noexcept {
+            return blocks[i >> BLOCK_BITS][i & (BLOCK_SIZE - 1)];
+        }
+
+        /// Liczba slotów, które kiedykolwiek były używane; indeksy węzłów są od niej mniejsze.
+        node_index size() const noexcept {
+            return cnt_slots;
+        }
 
-        ~Node() {
-            std::weak_ptr<Node> this_weak_ptr = this->weak_from_this();
-            if (iterator_in_map != (*publications_map_ptr).end())
-                (*publications_map_ptr).erase(iterator_in_map); // Nie rzuca wyjątku, bo comparator nie rzuca.
+        /// Może rzucić wyjątek (nowy blok) - strong guarantee
+        node_index allocate() {
+            if (first_free != NO_NODE) {
+                node_index i = first_free;
+                first_free = (*this)[i].next_free;
+                cnt_free--;
+                return i;
+            }
 
-            for (auto &child : children)
-                (*child).erase_parent(this_weak_ptr);
+            if (cnt_slots == blocks.size() * BLOCK_SIZE)
+                blocks.push_back(std::make_unique<Node[]>(BLOCK_SIZE));
+            return cnt_slots++;
         }
 
-        /// Może rzucić wyjątek, ale nic nie edytuje
-        std::vector<typename Publication::id_type> get_children_id() {
-            std::vector<typename Publication::id_type> children_id;
+        /// Nie rzuca wyjątku (zakładamy, jak wszędzie, że destruktor publikacji nie rzuca)
+        void release(node_index i) noexcept {
+            Node &node = (*this)[i];
+            node.record.reset();
+            node.children.clear();
+            node.parents.clear();
+            node.next_free = first_free;
+            first_free = i;
+            cnt_free++;
+        }
 
-            for (auto &child_ptr : this->children)
-                children_id.push_back((*child_ptr).get_publication().get_id());
+        /// Pamięć zajmowana przez bloki (razem z wolnymi slotami) i tablicę bloków
+        size_t bytes() const noexcept {
+            return blocks.size() * BLOCK_SIZE * sizeof(Node) + blocks.capacity() * sizeof(blocks[0]);
+        }
 
-            return children_id;
+        /// Przydziela bloki tak, by kolejne cnt_nodes wywołań allocate nie rzuciło wyjątku. Strong guarantee
+        void reserve(size_t cnt_nodes) {
+            while (cnt_free + blocks.size() * BLOCK_SIZE - cnt_slots < cnt_nodes)
+                blocks.push_back(std::make_unique<Node[]>(BLOCK_SIZE));
         }
+    };
+
+    /// Hash id, z którego korzysta indeks. Dla napisów liczony z widoku, więc tak samo dla id_type i lookup_type.
+    static uint32_t hash_tag(lookup_type id) {
+        using hashed_type = std::remove_cv_t<std::remove_reference_t<lookup_type>>;
+        return (std::hash<hashed_type>{}(id) * 0x9E3779B97F4A7C15ULL) >> 32;
+    }
 
-        /// Może rzucić wyjątek, ale nic nie edytuje
-        std::vector<typename Publication::id_type> get_parents_id() {
-            std::vector<typename Publication::id_type> parent_id;
+    /**
+     * Indeks publikacji: tablica haszująca z adresowaniem otwartym (liniowym). Slot przechowuje tylko numer
+     * węzła i hash, id porównujemy z id zapisanym w węźle, i to tylko przy zgodnym hashu. Przy usuwaniu
+     * przesuwamy kolejne elementy w miejsce usuniętego, więc nie zostają żadne znaczniki usunięcia.
+     */
+    class IdIndex {
+    private:
+        struct Slot {
+            node_index node;
+            uint32_t hash_tag;
+        };
 
-            for (auto &parent_ptr : this->parents)
-                parent_id.push_back(parent_ptr.lock()->get_publication().get_id());
+        static constexpr size_t MIN_CAPACITY = 16;
 
-            return parent_id;
+        std::vector<Slot> slots = std::vector<Slot>(MIN_CAPACITY, Slot{NO_NODE, 0});
+        size_t count = 0;
+
+        size_t mask() const noexcept {
+            return slots.size() - 1;
+        }
+
+    public:
+        size_t size() const noexcept {
+            return count;
+        }
+
+        size_t bytes() const noexcept {
+            return slots.capacity() * sizeof(Slot);
+        }
+
+        /// Zwraca pozycję slotu z publikacją o podanym id, a jeśli jej nie ma - pustego slotu, w który należy
+        /// ją wstawić. Nic nie edytuje.
+        size_t probe(lookup_type id, uint32_t tag, const NodeArena &nodes) const {
+            size_t position = tag & mask();
+            while (slots[position].node != NO_NODE
+                   && !(slots[position].hash_tag == tag && nodes[slots[position].node].record->id == id))
+                position = (position + 1) & mask();
+            return position;
+        }
+
+        /// Węzeł w slocie albo NO_NODE, jeśli slot jest pusty
+        node_index at(size_t position) const noexcept {
+            return slots[position].node;
+        }
+
+        /// Powiększa tablicę tak, by zmieściło się w niej cnt_elements elementów. Może rzucić wyjątek - strong
+        /// guarantee. Unieważnia pozycje zwrócone przez probe.
+        void reserve(size_t cnt_elements) {
+            size_t capacity = slots.size();
+            while (cnt_elements * 4 > capacity * 3)
+                capacity *= 2;
+            if (capacity == slots.size())
+                return;
+
+            std::vector<Slot> new_slots(capacity, Slot{NO_NODE, 0});
+            for (const Slot &slot : slots) {
+                if (slot.node == NO_NODE)
+                    continue;
+                size_t position = slot.hash_tag & (capacity - 1);
+                while (new_slots[position].node != NO_NODE)
+                    position = (position + 1) & (capacity - 1);
+                new_slots[position] = slot;
+            }
+            slots.swap(new_slots);
+        }
+
+        /// Wstawia węzeł w pusty slot wskazany przez probe. Nie rzuca wyjątku
+        void insert_at(size_t position, node_index node, uint32_t tag) noexcept {
+            slots[position] = {node, tag};
+            count++;
+        }
+
+        /// Usuwa węzeł o podanym hashu. Nie rzuca wyjątku
+        void erase(node_index node, uint32_t tag) noexcept {
+            size_t hole = tag & mask();
+            while (slots[hole].node != node)
+                hole = (hole + 1) & mask();
+
+            // Element przenosimy do dziury, jeśli jego pozycja docelowa nie leży między dziurą a nim.
+            for (size_t i = (hole + 1) & mask(); slots[i].node != NO_NODE; i = (i + 1) & mask()) {
+                size_t home = slots[i].hash_tag & mask();
+                if (((i - home) & mask()) >= ((i - hole) & mask())) {
+                    slots[hole] = slots[i];
+                    hole = i;
+                }
+            }
+            slots[hole].node = NO_NODE;
+            count--;
+        }
+    };
+
+    /**
+     * Zbiór odwiedzonych węzłów o rozmiarze proporcjonalnym do liczby odwiedzonych: najpierw tablica haszująca
+     * z adresowaniem otwartym, a gdy odwiedzonych jest więcej niż 1/64 wszystkich węzłów - wektor bitów po
+     * całej arenie, który wtedy nie jest większy od tablicy. Przejście kilku węzłów nie kosztuje więc
+     * O(rozmiar grafu).
+     */
+    class VisitedNodes {
+    private:
+        static constexpr size_t MIN_CAPACITY = 16;
+
+        size_t cnt_nodes;
+        std::vector<node_index> slots = std::vector<node_index>(MIN_CAPACITY, NO_NODE);
+        size_t count = 0;
+        std::vector<bool> bits; // Niepusty po przejściu na wektor bitów.
+
+        size_t position(node_index node) const noexcept {
+            return (node * 0x9E3779B97F4A7C15ULL >> 32) & (slots.size() - 1);
+        }
+
+        void insert_slot(node_index node) noexcept {
+            size_t i = position(node);
+            while (slots[i] != NO_NODE)
+                i = (i + 1) & (slots.size() - 1);
+            slots[i] = node;
+        }
+
+        bool insert_slot_or_bit(node_index node) {
+            if (contains(node))
+                return false;
+            if (2 * (count + 1) > slots.size())
+                grow();
+            if (bits.empty())
+                insert_slot(node);
+            else
+                bits[node] = true;
+            count++;
+            return true;
+        }
+
+        void grow() {
+            if (64 * count > cnt_nodes) {
+                bits.resize(cnt_nodes);
+                for (node_index node : slots)
+                    if (node != NO_NODE)
+                        bits[node] = true;
+                slots = std::vector<node_index>();
+                return;
+            }
+            std::vector<node_index> old_slots(2 * slots.size(), NO_NODE);
+            old_slots.swap(slots);
+            for (node_index node : old_slots)
+                if (node != NO_NODE)
+                    insert_slot(node);
+        }
+
+    public:
+        /// cnt_nodes - rozmiar areny, numery węzłów są od niego mniejsze.
+        explicit VisitedNodes(size_t cnt_nodes) : cnt_nodes(cnt_nodes) {}
+
+        bool contains(node_index node) const noexcept {
+            if (!bits.empty())
+                return bits[node];
+            for (size_t i = position(node); slots[i] != NO_NODE; i = (i + 1) & (slots.size() - 1))
+                if (slots[i] == node)
+                    return true;
+            return false;
+        }
+
+        /// Dodaje węzeł. Zwraca false, jeśli był już odwiedzony.
+        bool insert(node_index node) {
+            if (bits.empty())
+                return insert_slot_or_bit(node);
+            if (bits[node])
+                return false;
+            bits[node] = true;
+            return true;
         }
     };
 
-    // Dzięki temu że są to wskaźniki to konstruktor przenoszący staje się prosty
-    std::shared_ptr<std::map<typename Publication::id_type, std::weak_ptr<Node>>> publications_map;
-    std::shared_ptr<Node> root_ptr; // root będzie zniszczony najpierw, bo jest później zadeklarowany
+    struct Storage {
+        NodeArena nodes;
+        IdIndex index;
+        node_index root = NO_NODE;
+        uint64_t cnt_created = 0;
+        // Czy add_citation dodało krawędź do publikacji starszej niż cytująca - tylko wtedy może powstać cykl.
+        bool may_have_cycles = false;
+    };
 
 public:
-    // Sprawdza, czy publikacja o podanym id istnieje.
-    bool exists(typename Publication::id_type const &id) const {
-        auto it = (*publications_map).find(id);
-        return it != (*publications_map).end() && !it->second.expired();
-    }
+    /**
+     * Widok na identyfikatory sąsiadów publikacji (cytujących albo cytowanych). Niczego nie kopiuje,
+     * identyfikatory są czytane z grafu dopiero przy przejściu po widoku. Widok (i referencje, które zwraca)
+     * jest ważny do najbliższej zmiany grafu.
+     */
+    class NeighbourView {
+    public:
+        class iterator {
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = id_type;
+            using difference_type = std::ptrdiff_t;
+            using pointer = const id_type *;
+            using reference = const id_type &;
+
+            iterator() = default;
+
+            reference operator*() const noexcept {
+                return (*nodes)[edge->node].record->id;
+            }
+
+            pointer operator->() const noexcept {
+                return &**this;
+            }
+
+            iterator& operator++() noexcept {
+                edge++;
+                return *this;
+            }
+
+            iterator operator++(int) noexcept {
+                iterator result = *this;
+                edge++;
+                return result;
+            }
+
+            bool operator==(const iterator &other) const noexcept {
+                return edge == other.edge;
+            }
+
+            bool operator!=(const iterator &other) const noexcept {
+                return edge != other.edge;
+            }
+
+        private:
+            friend class NeighbourView;
+
+            const NodeArena *nodes = nullptr;
+            const Edge *edge = nullptr;
+
+            iterator(const NodeArena *nodes, const Edge *edge) noexcept : nodes(nodes), edge(edge) {}
+        };
+
+        iterator begin() const noexcept {
+            return iterator(nodes, list->begin());
+        }
+
+        iterator end() const noexcept {
+            return iterator(nodes, list->end());
+        }
+
+        size_t size() const noexcept {
+            return list->size();
+        }
+
+        bool empty() const noexcept {
+            return list->empty();
+        }
+
+    private:
+        friend class CitationGraph;
+
+        const NodeArena *nodes;
+        const Adjacency *list;
+
+        NeighbourView(const NodeArena *nodes, const Adjacency *list) noexcept : nodes(nodes), list(list) {}
+    };
 
 private:
-    void checkExistence(typename Publication::id_type id) const {
-        if (!exists(id))
-            throw PublicationNotFound();
+    // Dzięki temu że jest to wskaźnik to konstruktor przenoszący staje się prosty
+    std::unique_ptr<Storage> storage;
+
+    /// Zwraca indeks węzła o podanym id albo NO_NODE. Może rzucić wyjątek, ale nic nie edytuje.
+    node_index find(lookup_type id) const {
+        return storage->index.at(storage->index.probe(id, hash_tag(id), storage->nodes));
     }
 
-    void checkNoExistence(typename Publication::id_type const &id) const {
-        if (exists(id))
-            throw PublicationAlreadyCreated();
+    /// Usuwa pozycję i z listy sąsiadów, poprawiając krawędź odwrotną przeniesionej na jej miejsce pozycji.
+    /// Nie rzuca wyjątku
+    void erase_entry(Adjacency &list, uint32_t i, Adjacency Node::*opposite) noexcept {
+        Edge last = list.back();
+        list.pop_back();
+        if (i < list.size()) {
+            list[i] = last;
+            (storage->nodes[last.node].*opposite)[last.back].back = i;
+        }
+    }
+
+    /// Usuwa krawędź z parent do jego i-tego dziecka. Nie rzuca wyjątku
+    void unlink(node_index parent, uint32_t i) noexcept {
+        Edge edge = storage->nodes[parent].children[i];
+        erase_entry(storage->nodes[edge.node].parents, edge.back, &Node::children);
+        erase_entry(storage->nodes[parent].children, i, &Node::parents);
+    }
+
+    /// Dodaje krawędź z parent do child. Nie rzuca wyjątku, jeśli na obu listach zarezerwowano miejsce.
+    void link(node_index parent, node_index child) {
+        Node &parent_node = storage->nodes[parent], &child_node = storage->nodes[child];
+        uint32_t child_position = parent_node.children.size(), parent_position = child_node.parents.size();
+
+        parent_node.children.push_back({child, parent_position});
+        child_node.parents.push_back({parent, child_position});
+    }
+
+    bool is_linked(node_index parent, node_index child) const noexcept {
+        const Node &parent_node = storage->nodes[parent], &child_node = storage->nodes[child];
+        auto is_edge_to = [](node_index node) { return [node](const Edge &edge) { return edge.node == node; }; };
+
+        if (parent_node.children.size() < child_node.parents.size())
+            return std::any_of(parent_node.children.begin(), parent_node.children.end(), is_edge_to(child));
+        return std::any_of(child_node.parents.begin(), child_node.parents.end(), is_edge_to(parent));
+    }
+
+    /// Zwalnia węzeł razem ze wszystkimi jego krawędziami i usuwa go z indeksu. Nie rzuca wyjątku
+    void release(node_index i) noexcept {
+        Node &node = storage->nodes[i];
+        while (!node.parents.empty())
+            unlink(node.parents.back().node, node.parents.back().back);
+        while (!node.children.empty())
+            unlink(i, node.children.size() - 1);
+        storage->index.erase(i, node.hash_tag);
+        storage->nodes.release(i);
+    }
+
+    /**
+     * Usuwanie w grafie bez cykli: węzeł jest osiągalny ze źródła wtw, gdy ma rodzica (albo jest źródłem),
+     * więc zwalniamy kolejno węzły, którym nie został żaden rodzic. Lista węzłów do zwolnienia jest wpleciona
+     * w same węzły (pole next_free), więc nic nie alokujemy i nie używamy rekurencji. Czas jest liniowy
+     * względem zwalnianego podgrafu. Nie rzuca wyjątku
+     */
+    void remove_acyclic(node_index to_remove) noexcept {
+        NodeArena &nodes = storage->nodes;
+        Adjacency &parents = nodes[to_remove].parents;
+        while (!parents.empty())
+            unlink(parents.back().node, parents.back().back);
+
+        node_index worklist = to_remove;
+        nodes[to_remove].next_free = NO_NODE;
+        while (worklist != NO_NODE) {
+            node_index node = worklist;
+            worklist = nodes[node].next_free;
+
+            Adjacency &children = nodes[node].children;
+            while (!children.empty()) {
+                node_index child = children.back().node;
+                unlink(node, children.size() - 1);
+                if (nodes[child].parents.empty() && child != storage->root) {
+                    nodes[child].next_free = worklist;
+                    worklist = child;
+                }
+            }
+            release(node);
+        }
+    }
+
+    /**
+     * Usuwanie w grafie, który może mieć cykle - próbne usuwanie (trial deletion) znane ze zbierania cykli
+     * przy zliczaniu referencji. Referencjami węzła są krawędzie od rodziców, źródło ma jedną dodatkową.
+     * 1. Kaskada jak w grafie bez cykli: giną węzły, którym nie został żaden rodzic. Węzły, które straciły
+     *    rodzica, ale mają innych, są kandydatami - mogą należeć do cyklu odciętego od źródła.
+     * 2. W podgrafie osiągalnym z kandydatów od liczby rodziców odejmujemy krawędzie wewnątrz podgrafu.
+     *    Węzeł z dodatnim wynikiem ma rodzica spoza podgrafu (albo jest źródłem), więc jest osiągalny
+     *    ze źródła - tak jak wszystko, co jest osiągalne z niego.
+     * 3. Pozostałe węzły podgrafu są osiągalne tylko z siebie nawzajem i giną.
+     * Czas jest liniowy względem potomków usuwanego węzła, a nie całego grafu. Węzły do zwolnienia
+     * wyznaczamy, zanim cokolwiek zmienimy, więc wyjątek (brak pamięci) zostawia graf nietknięty.
+     */
+    void remove_with_cycles(node_index to_remove) {
+        const NodeArena &nodes = storage->nodes;
+        node_index root = storage->root;
+
+        // Dla węzłów, które straciły rodzica - ilu rodziców im zostało; 0 oznacza węzeł do zwolnienia.
+        std::unordered_map<node_index, uint32_t> cnt_parents_left = {{to_remove, 0}};
+        std::vector<node_index> doomed = {to_remove};
+        for (size_t next = 0; next < doomed.size(); next++) {
+            for (const Edge &edge : nodes[doomed[next]].children) {
+                uint32_t &cnt_left = cnt_parents_left.try_emplace(edge.node, nodes[edge.node].parents.size())
+                        .first->second;
+                if (cnt_left > 0 && --cnt_left == 0 && edge.node != root)
+                    doomed.push_back(edge.node);
+            }
+        }
+        auto is_doomed = [&](node_index node) {
+            auto found = cnt_parents_left.find(node);
+            return found != cnt_parents_left.end() && found->second == 0 && node != root;
+        };
+
+        // Liczniki referencji w podgrafie kandydatów pomniejszone o krawędzie wewnętrzne. Źródło nigdy
+        // nie jest kandydatem - jego potomkowie na pewno przeżyją.
+        constexpr uint32_t REACHABLE = UINT32_MAX;
+        std::unordered_map<node_index, uint32_t> cnt_external;
+        std::vector<node_index> subgraph;
+        for (auto [node, cnt_left] : cnt_parents_left) {
+            if (cnt_left > 0 && node != root) {
+                cnt_external.emplace(node, cnt_left);
+                subgraph.push_back(node);
+            }
+        }
+        for (size_t next = 0; next < subgraph.size(); next++) {
+            for (const Edge &edge : nodes[subgraph[next]].children) {
+                if (is_doomed(edge.node))
+                    continue;
+                auto [found, inserted] = cnt_external.try_emplace(edge.node, 0);
+                if (inserted) {
+                    // Poza kandydatami nikt nie stracił rodzica, a źródło ma referencję z zewnątrz.
+                    auto left = cnt_parents_left.find(edge.node);
+                    found->second = left != cnt_parents_left.end() ? left->second : nodes[edge.node].parents.size();
+                    found->second += edge.node == root;
+                    subgraph.push_back(edge.node);
+                }
+                found->second--;
+            }
+        }
+
+        std::vector<node_index> stack;
+        for (node_index node : subgraph) {
+            uint32_t &cnt = cnt_external[node];
+            if (cnt == 0 || cnt == REACHABLE)
+                continue;
+            cnt = REACHABLE;
+            stack.push_back(node);
+            while (!stack.empty()) {
+                node_index reachable = stack.back();
+                stack.pop_back();
+                for (const Edge &edge : nodes[reachable].children) {
+                    auto found = cnt_external.find(edge.node);
+                    if (found != cnt_external.end() && found->second != REACHABLE) {
+                        found->second = REACHABLE;
+                        stack.push_back(edge.node);
+                    }
+                }
+            }
+        }
+        for (node_index node : subgraph)
+            if (cnt_external[node] != REACHABLE)
+                doomed.push_back(node);
+
+        for (node_index node : doomed)
+            release(node);
+    }
+
+    /**
+     * Przechodzi wszerz węzły osiągalne ze start krawędziami z list neighbours, najwyżej max_depth krawędzi
+     * od start. visit(node, depth) jest wołane w kolejności odległości. Zwraca liczbę odwiedzonych węzłów.
+     */
+    template <class Visitor>
+    size_t bfs_nodes(node_index start, Adjacency Node::*neighbours, size_t max_depth, Visitor &&visit) const {
+        const NodeArena &nodes = storage->nodes;
+        VisitedNodes visited(nodes.size());
+        std::vector<node_index> queue = {start};
+        visited.insert(start);
+
+        // Kolejka jest wektorem: węzły z odległości depth zajmują [level_begin, level_end).
+        for (size_t level_begin = 0, depth = 0; level_begin < queue.size(); depth++) {
+            size_t level_end = queue.size();
+            for (size_t i = level_begin; i < level_end; i++) {
+                visit(queue[i], depth);
+                if (depth == max_depth)
+                    continue;
+                for (const Edge &edge : nodes[queue[i]].*neighbours)
+                    if (visited.insert(edge.node))
+                        queue.push_back(edge.node);
+            }
+            level_begin = level_end;
+        }
+
+        return queue.size();
+    }
+
+    /**
+     * Przechodzenie wszerz po poziomach: kolejny poziom wyznacza cnt_threads wątków, z których każdy bierze
+     * paczki węzłów bieżącego poziomu i zbiera ich nieodwiedzonych sąsiadów. Węzeł przypada temu wątkowi,
+     * który pierwszy ustawi jego znacznik. visit jest wołane współbieżnie i nie może rzucać wyjątków.
+     * Zwraca liczbę odwiedzonych węzłów.
+     */
+    template <class Visitor>
+    size_t parallel_bfs_nodes(node_index start, Adjacency Node::*neighbours, unsigned cnt_threads,
+                              Visitor &&visit) const {
+        constexpr size_t CHUNK_SIZE = 1024;
+        const NodeArena &nodes = storage->nodes;
+        std::vector<std::atomic<bool>> visited(nodes.size());
+        std::vector<node_index> level = {start};
+        std::vector<std::vector<node_index>> next_levels(cnt_threads);
+        visited[start] = true;
+        size_t cnt_visited = 0;
+
+        for (size_t depth = 0; !level.empty(); depth++) {
+            std::atomic<size_t> next_chunk{0};
+            auto worker = [&](unsigned thread_id) {
+                std::vector<node_index> &next_level = next_levels[thread_id];
+                for (size_t begin = next_chunk.fetch_add(CHUNK_SIZE); begin < level.size();
+                     begin = next_chunk.fetch_add(CHUNK_SIZE)) {
+                    for (size_t i = begin; i < std::min(level.size(), begin + CHUNK_SIZE); i++) {
+                        visit(level[i], depth);
+                        for (const Edge &edge : nodes[level[i]].*neighbours)
+                            if (!visited[edge.node].load(std::memory_order_relaxed)
+                                && !visited[edge.node].exchange(true, std::memory_order_relaxed))
+                                next_level.push_back(edge.node);
+                    }
+                }
+            };
+
+            // Małych poziomów nie opłaca się dzielić między wątki.
+            if (cnt_threads == 1 || level.size() <= CHUNK_SIZE) {
+                worker(0);
+            } else {
+                std::vector<std::thread> threads;
+                for (unsigned thread_id = 1; thread_id < cnt_threads; thread_id++)
+                    threads.emplace_back(worker, thread_id);
+                worker(0);
+                for (std::thread &thread : threads)
+                    thread.join();
+            }
+
+            cnt_visited += level.size();
+            level.clear();
+            for (std::vector<node_index> &next_level : next_levels) {
+                level.insert(level.end(), next_level.begin(), next_level.end());
+                next_level.clear();
+            }
+        }
+
+        return cnt_visited;
+    }
+
+    static Adjacency Node::*neighbours(Direction direction) noexcept {
+        return direction == Direction::children ? &Node::children : &Node::parents;
+    }
+
+    size_t count_reachable(node_index start, Adjacency Node::*next, unsigned cnt_threads) const {
+        if (cnt_threads > 1)
+            return parallel_bfs_nodes(start, next, cnt_threads, [](node_index, size_t) {}) - 1;
+        return bfs_nodes(start, next, SIZE_MAX, [](node_index, size_t) {}) - 1;
+    }
+
+    std::vector<id_type> get_ids(const Adjacency &list) const {
+        std::vector<id_type> ids;
+        ids.reserve(list.size());
+
+        for (const Edge &edge : list)
+            ids.push_back(storage->nodes[edge.node].record->id);
+
+        return ids;
+    }
+
+    /// Zgłasza wyjątek PublicationNotFound, jeśli publikacja nie istnieje.
+    node_index checkExistence(lookup_type id) const {
+        node_index i = find(id);
+        if (i == NO_NODE)
+            throw PublicationNotFound();
+        return i;
     }
 
     /**
@@ -136,72 +828,95 @@ private:
      * 1. Vector nie może byc pusty
      * 2. Każda publikacja podana w wektorze musi istnieć w grafie
      * Jeśli któryś z warunków nie jest spełniony wyjątek PublicationNotFound zostaje rzucony.
+     * Zwraca posortowane indeksy rodziców bez powtórzeń.
      */
-    void checkParentsExistence(std::vector<typename Publication::id_type> const &parents_ids) const {
+    std::vector<node_index> checkParentsExistence(std::vector<id_type> const &parents_ids) const {
         if (parents_ids.empty())
             throw PublicationNotFound();
 
+        std::vector<node_index> parents;
+        parents.reserve(parents_ids.size());
         for (auto &pub_id : parents_ids)
-            if (!exists(pub_id))
-                throw PublicationNotFound();
+            parents.push_back(checkExistence(pub_id));
+
+        std::sort(parents.begin(), parents.end());
+        parents.erase(std::unique(parents.begin(), parents.end()), parents.end());
+        return parents;
     }
 
-    ///Sprawdza czy podane id jest id roota, jeśli tak to rzuca wyjątek TriedToRemoveRoot
-    void checkRootDeletion(typename Publication::id_type id) const {
-        if (id == get_root_id())
+    ///Sprawdza czy podany węzeł jest rootem, jeśli tak to rzuca wyjątek TriedToRemoveRoot
+    void checkRootDeletion(node_index i) const {
+        if (i == storage->root)
             throw TriedToRemoveRoot();
     }
 
 public:
+    // Sprawdza, czy publikacja o podanym id istnieje.
+    bool exists(lookup_type id) const {
+        return find(id) != NO_NODE;
+    }
+
     // Tworzy nowy graf. Tworzy także węzeł publikacji o identyfikatorze stem_id
-    explicit CitationGraph(typename Publication::id_type const &stem_id) {
-        publications_map = std::make_shared<std::map<typename Publication::id_type, std::weak_ptr<Node>>>();
-        root_ptr = std::make_shared<Node>(stem_id, publications_map);
-        auto feedback = (*publications_map).insert({stem_id, std::weak_ptr(root_ptr)});
-        (*root_ptr).set_iterator(feedback.first);
+    explicit CitationGraph(id_type const &stem_id) : storage(std::make_unique<Storage>()) {
+        node_index root = storage->nodes.allocate();
+        Node &root_node = storage->nodes[root];
+        root_node.record.emplace(stem_id);
+        root_node.hash_tag = hash_tag(stem_id);
+        storage->index.insert_at(storage->index.probe(stem_id, root_node.hash_tag, storage->nodes), root,
+                                 root_node.hash_tag);
+        storage->root = root;
     }
 
     // Konstruktor przenoszący i przenoszący operator przypisania. Powinny być noexcept
     CitationGraph(CitationGraph<Publication> &&other) noexcept {
-        std::swap(this->root_ptr, other.root_ptr);
-        std::swap(this->publications_map, other.publications_map);
+        std::swap(this->storage, other.storage);
     }
 
     CitationGraph<Publication>& operator=(CitationGraph<Publication> &&other) noexcept {
-        std::swap(this->root_ptr, other.root_ptr);
-        std::swap(this->publications_map, other.publications_map);
+        std::swap(this->storage, other.storage);
 
         return *this;
     }
 
     // Zwraca identyfikator źródła. Metoda ta powinna być noexcept wtw, gdy metoda Publication::get_id jest noexcept.
-    typename Publication::id_type get_root_id() const noexcept(noexcept(std::declval<Publication>().get_id())) {
-        return (*root_ptr).get_publication().get_id();
+    id_type get_root_id() const noexcept(noexcept(std::declval<Publication>().get_id())) {
+        return storage->nodes[storage->root].record->publication.get_id();
     }
 
     // Zwraca listę identyfikatorów publikacji cytujących publikację o podanym identyfikatorze.
     // Zgłasza wyjątek PublicationNotFound, jeśli dana publikacja nie istnieje.
-    std::vector<typename Publication::id_type> get_children(typename Publication::id_type const &id) const {
-        checkExistence(id);
+    std::vector<id_type> get_children(lookup_type id) const {
+        return get_ids(storage->nodes[checkExistence(id)].children);
+    }
+
+    std::vector<id_type> get_parents(lookup_type id) const {
+        return get_ids(storage->nodes[checkExistence(id)].parents);
+    }
+
+    // Tak jak get_children i get_parents, ale bez kopiowania identyfikatorów - zwraca widok ważny
+    // do najbliższej zmiany grafu.
+    NeighbourView children_view(lookup_type id) const {
+        return NeighbourView(&storage->nodes, &storage->nodes[checkExistence(id)].children);
+    }
 
-        std::shared_ptr node_ptr = (*publications_map).find(id)->second.lock();
-        return (*node_ptr).get_children_id();
+    NeighbourView parents_view(lookup_type id) const {
+        return NeighbourView(&storage->nodes, &storage->nodes[checkExistence(id)].parents);
     }
 
-    std::vector<typename Publication::id_type> get_parents(typename Publication::id_type const &id) const {
-        checkExistence(id);
+    // Liczba publikacji cytujących / cytowanych przez publikację o podanym id, w czasie stałym.
+    // Zgłasza wyjątek PublicationNotFound, jeśli dana publikacja nie istnieje.
+    size_t count_children(lookup_type id) const {
+        return storage->nodes[checkExistence(id)].children.size();
+    }
 
-        std::shared_ptr node_ptr = (*publications_map).find(id)->second.lock();
-        return (*node_ptr).get_parents_id();
+    size_t count_parents(lookup_type id) const {
+        return storage->nodes[checkExistence(id)].parents.size();
     }
 
     // Zwraca referencję do obiektu reprezentującego publikację o podanym id. Zgłasza wyjątek PublicationNotFound,
     // jeśli żądana publikacja nie istnieje
-    Publication& operator[](typename Publication::id_type const &id) const {
-        checkExistence(id);
-
-        std::shared_ptr<Node> node_ptr = (*publications_map).find(id)->second.lock();
-        return node_ptr->get_publication();
+    Publication& operator[](lookup_type id) const {
+        return storage->nodes[checkExistence(id)].record->publication;
     }
 
     // Tworzy węzeł reprezentujący nową publikację o identyfikatorze id cytującą
@@ -209,69 +924,307 @@ public:
     // parent_ids. Zgłasza wyjątek PublicationAlreadyCreated, jeśli publikacja
     // o identyfikatorze id już istnieje. Zgłasza wyjątek PublicationNotFound, jeśli
     // któryś z wyspecyfikowanych poprzedników nie istnieje albo lista poprzedników jest pusta.
-    void create(typename Publication::id_type const &id, typename Publication::id_type const &parent_id) {
-        create(id, std::vector<typename Publication::id_type> {parent_id});
+    void create(id_type const &id, id_type const &parent_id) {
+        create(id, std::vector<id_type> {parent_id});
     }
 
-    void create(typename Publication::id_type const &id, std::vector<typename Publication::id_type> const &parent_ids) {
-        checkNoExistence(id);
-        checkParentsExistence(parent_ids);
-
-        std::shared_ptr<Node> new_node = std::make_shared<Node>(id, publications_map);
+    void create(id_type const &id, std::vector<id_type> const &parent_ids) {
+        // Jedno wyszukanie: pozycja zwrócona przez probe posłuży do wstawienia (do tego czasu indeks się nie zmienia).
+        IdIndex &index = storage->index;
+        index.reserve(index.size() + 1);
+        uint32_t tag = hash_tag(id);
+        size_t position = index.probe(id, tag, storage->nodes);
+        if (index.at(position) != NO_NODE)
+            throw PublicationAlreadyCreated();
+        std::vector<node_index> parents = checkParentsExistence(parent_ids);
 
-        for (auto &parent_id : parent_ids)   // Nawet jak rzuci wyjątek to ok - new_node po prostu zniknie
-            (*new_node).add_parent((*publications_map).find(parent_id)->second);
+        // Wszystko, co może rzucić wyjątek, robimy zanim graf zostanie zmieniony: rezerwacja miejsca
+        // na listach nie jest widoczna z zewnątrz.
+        for (node_index parent : parents) {
+            Adjacency &children = storage->nodes[parent].children;
+            children.reserve(children.size() + 1);
+        }
 
-        std::vector<std::shared_ptr<Node>> edited_parents;
+        node_index new_node = storage->nodes.allocate();
+        Node &node = storage->nodes[new_node];
         try {
-            // Może rzucić wyjątek przy każdym szukaniu / wstawieniu, dlatego zapamiętujemy znalezione POINTERY,
-            // które nie rzucą wyjątku gdy będziemy chcieli cofnąć wykonane zmiany - usunąć ze zbioru dzieci
-            // NAJPIERW dodajemy do wektora (na wypadek błędu) - ewentualne usuwanie dziecka rodzica
-            // które nie istnieje nie będzie problemem (brak efektu).
-            for (auto &parent_id : parent_ids) {
-                std::shared_ptr<Node> parent_ptr = (*publications_map).find(parent_id)->second.lock();
-                edited_parents.push_back(parent_ptr);
-                parent_ptr->add_child(new_node);
-            }
-
-            // Może rzucić wyjątek. Robimy to na koniec, ponieważ usuwanie potem znowu mogłoby rzucić wyjątek.
-            auto feedback = (*publications_map).insert({id, new_node});
-            (*new_node).set_iterator(feedback.first);
+            node.parents.reserve(parents.size());
+            node.record.emplace(id); // Ostatnia operacja, która może rzucić wyjątek.
         } catch (...) {
-            for (auto &parent : edited_parents)
-                (*parent).erase_child(new_node);
+            storage->nodes.release(new_node);
             throw;
         }
+
+        node.hash_tag = tag;
+        node.creation_order = ++storage->cnt_created;
+        index.insert_at(position, new_node, tag);
+
+        for (node_index parent : parents)
+            link(parent, new_node);
     }
 
-    // Dodaje nową krawędź w grafie cytowań. Zgłasza wyjątek PublicationNotFound,
-    // jeśli któraś z podanych publikacji nie istnieje.
-    void add_citation(typename Publication::id_type const &child_id, typename Publication::id_type const &parent_id) {
-        checkExistence(child_id);
-        checkExistence(parent_id);
+    // Rekord ładowania wsadowego: id publikacji i identyfikatory publikacji przez nią cytowanych.
+    using Citations = std::pair<id_type, std::vector<id_type>>;
+
+    // Tworzy publikacje z podanych rekordów tak, jakby dla każdego z nich po kolei wywołać create,
+    // ale wszystko albo nic: w razie wyjątku (tych samych co w create) graf pozostaje niezmieniony.
+    // Rekordy muszą być w porządku topologicznym - publikacja może cytować tylko istniejące
+    // publikacje albo utworzone przez wcześniejsze rekordy.
+    void create_all(std::vector<Citations> const &records) {
+        create_all(records.begin(), records.end());
+    }
 
-        std::shared_ptr<Node> child_ptr((*publications_map).find(child_id)->second);
-        std::shared_ptr<Node> parent_ptr((*publications_map).find(parent_id)->second);
+    // Tak jak create_all(records), ale rekordy (pary id i identyfikatorów cytowanych publikacji) są czytane
+    // wprost z zakresu [first, last), bez kopiowania. Zakres przechodzony jest raz; jeśli iteratory są
+    // co najmniej jednokierunkowe, indeks i arena są od razu powiększane dla całego wsadu.
+    template <class InputIterator>
+    void create_all(InputIterator first, InputIterator last) {
+        IdIndex &index = storage->index;
+        NodeArena &nodes = storage->nodes;
+        std::vector<node_index> created;
+        std::vector<node_index> parents;
 
-        (*parent_ptr).add_child(child_ptr); // Pierwsza zmiana w strukturze
+        using Category = typename std::iterator_traits<InputIterator>::iterator_category;
+        if constexpr (std::is_base_of_v<std::forward_iterator_tag, Category>) {
+            size_t cnt_records = std::distance(first, last);
+            index.reserve(index.size() + cnt_records);
+            nodes.reserve(cnt_records);
+            created.reserve(cnt_records);
+        }
+
+        // Wycofanie wsadu to zwolnienie utworzonych węzłów razem z ich krawędziami - to nie rzuca wyjątku,
+        // a pozostała po nim zarezerwowana pamięć nie jest widoczna z zewnątrz.
         try {
-            (*child_ptr).add_parent(std::weak_ptr<Node>(parent_ptr));
+            for (; first != last; ++first) {
+                auto &&record = *first;
+                index.reserve(index.size() + 1); // Bez długości zakresu indeks rośnie w miarę wstawiania.
+                uint32_t tag = hash_tag(record.first);
+                size_t position = index.probe(record.first, tag, nodes);
+                if (index.at(position) != NO_NODE)
+                    throw PublicationAlreadyCreated();
+                if (record.second.empty())
+                    throw PublicationNotFound();
+
+                parents.clear();
+                for (auto &parent_id : record.second)
+                    parents.push_back(checkExistence(parent_id));
+                std::sort(parents.begin(), parents.end());
+                parents.erase(std::unique(parents.begin(), parents.end()), parents.end());
+
+                node_index new_node = nodes.allocate();
+                try {
+                    nodes[new_node].record.emplace(record.first);
+                } catch (...) {
+                    nodes.release(new_node);
+                    throw;
+                }
+                nodes[new_node].hash_tag = tag;
+                nodes[new_node].creation_order = storage->cnt_created + created.size() + 1;
+                index.insert_at(position, new_node, tag);
+                created.push_back(new_node);
+
+                nodes[new_node].parents.reserve(parents.size());
+                for (node_index parent : parents)
+                    link(parent, new_node);
+            }
         } catch (...) {
-            (*parent_ptr).erase_child(child_ptr);
+            for (node_index node : created)
+                release(node);
             throw;
         }
+
+        storage->cnt_created += created.size();
+    }
+
+    // Dodaje nową krawędź w grafie cytowań. Zgłasza wyjątek PublicationNotFound,
+    // jeśli któraś z podanych publikacji nie istnieje.
+    void add_citation(lookup_type child_id, lookup_type parent_id) {
+        node_index child = checkExistence(child_id);
+        node_index parent = checkExistence(parent_id);
+        if (is_linked(parent, child))
+            return;
+
+        Adjacency &children = storage->nodes[parent].children, &parents = storage->nodes[child].parents;
+        children.reserve(children.size() + 1);
+        parents.reserve(parents.size() + 1);
+        link(parent, child);
+        if (storage->nodes[parent].creation_order >= storage->nodes[child].creation_order)
+            storage->may_have_cycles = true;
     }
 
     // Usuwa publikację o podanym identyfikatorze. Zgłasza wyjątek
     // PublicationNotFound, jeśli żądana publikacja nie istnieje. Zgłasza wyjątek
     // TriedToRemoveRoot przy próbie usunięcia pierwotnej publikacji.
     // W wypadku rozspójnienia grafu, zachowujemy tylko spójną składową zawierającą źródło.
-    void remove(typename Publication::id_type const &id) {
-        checkExistence(id);
-        checkRootDeletion(id);
+    void remove(lookup_type id) {
+        node_index to_remove = checkExistence(id);
+        checkRootDeletion(to_remove);
+
+        if (storage->may_have_cycles)
+            remove_with_cycles(to_remove);
+        else
+            remove_acyclic(to_remove);
+    }
+
+    // Przechodzi wszerz publikacje osiągalne z publikacji o podanym id (łącznie z nią) w podanym kierunku,
+    // najwyżej max_depth cytowań od niej. Woła visit(publication, depth) w kolejności odległości depth,
+    // z publikacją tylko do odczytu. Zgłasza wyjątek PublicationNotFound, jeśli dana publikacja nie istnieje.
+    template <class Visitor>
+    void bfs(lookup_type id, Visitor visit, Direction direction = Direction::children,
+             size_t max_depth = SIZE_MAX) const {
+        const NodeArena &nodes = storage->nodes;
+        bfs_nodes(checkExistence(id), neighbours(direction), max_depth,
+                  [&nodes, &visit](node_index node, size_t depth) { visit(nodes[node].record->publication, depth); });
+    }
+
+    // Przechodzi w głąb (preorder) publikacje osiągalne z publikacji o podanym id (łącznie z nią)
+    // w podanym kierunku, wołając visit(publication) z publikacją tylko do odczytu. Stos jest jawny, więc
+    // głębokość grafu nie ma znaczenia. Zgłasza wyjątek PublicationNotFound, jeśli dana publikacja nie istnieje.
+    template <class Visitor>
+    void dfs(lookup_type id, Visitor visit, Direction direction = Direction::children) const {
+        const NodeArena &nodes = storage->nodes;
+        Adjacency Node::*next = neighbours(direction);
+        VisitedNodes visited(nodes.size());
+        std::vector<node_index> stack = {checkExistence(id)};
+
+        while (!stack.empty()) {
+            node_index node = stack.back();
+            stack.pop_back();
+            if (!visited.insert(node))
+                continue;
+            visit(nodes[node].record->publication);
+
+            const Adjacency &list = nodes[node].*next;
+            for (uint32_t i = list.size(); i > 0; i--)
+                if (!visited.contains(list[i - 1].node))
+                    stack.push_back(list[i - 1].node);
+        }
+    }
+
+    // Przechodzi wszerz tak jak bfs, ale kolejne poziomy wyznacza cnt_threads wątków. Kolejność odwiedzin
+    // w ramach poziomu jest dowolna, visit jest wołane współbieżnie i nie może rzucać wyjątków.
+    template <class Visitor>
+    void parallel_bfs(lookup_type id, Visitor visit, unsigned cnt_threads,
+                      Direction direction = Direction::children) const {
+        const NodeArena &nodes = storage->nodes;
+        parallel_bfs_nodes(checkExistence(id), neighbours(direction), std::max(cnt_threads, 1u),
+                           [&nodes, &visit](node_index node, size_t depth) {
+            visit(nodes[node].record->publication, depth);
+        });
+    }
+
+    // Zwraca liczbę publikacji, które (pośrednio) cytują publikację o podanym id. Dla cnt_threads > 1 graf
+    // jest przechodzony równolegle. Zgłasza wyjątek PublicationNotFound, jeśli dana publikacja nie istnieje.
+    size_t count_descendants(lookup_type id, unsigned cnt_threads = 1) const {
+        return count_reachable(checkExistence(id), &Node::children, cnt_threads);
+    }
+
+    // Zwraca liczbę publikacji (pośrednio) cytowanych przez publikację o podanym id.
+    size_t count_ancestors(lookup_type id, unsigned cnt_threads = 1) const {
+        return count_reachable(checkExistence(id), &Node::parents, cnt_threads);
+    }
 
-        auto to_remove = (*publications_map).find(id); // Może rzucić wyjątek, ale to ok.
-        to_remove->second.lock()->erase_from_parents(); // Pierwsze zmiany w strukturze, ale tu nie rzuci już wyjątku.
+    // Zwraca identyfikatory publikacji odległych o 1..k cytowań od publikacji o podanym id w podanym kierunku,
+    // w kolejności odległości. Zgłasza wyjątek PublicationNotFound, jeśli dana publikacja nie istnieje.
+    std::vector<id_type> k_hop(lookup_type id, size_t k, Direction direction = Direction::children) const {
+        std::vector<id_type> ids;
+        bfs_nodes(checkExistence(id), neighbours(direction), k, [this, &ids](node_index node, size_t depth) {
+            if (depth > 0)
+                ids.push_back(storage->nodes[node].record->id);
+        });
+        return ids;
+    }
+
+    // Zwraca identyfikatory wszystkich publikacji w kolejności, w której każda publikacja występuje po
+    // publikacjach przez nią cytowanych. Zgłasza wyjątek CitationCycle, jeśli cytowania tworzą cykl.
+    std::vector<id_type> topological_order() const {
+        const NodeArena &nodes = storage->nodes;
+        std::vector<uint32_t> cnt_waiting(nodes.size());
+        std::vector<node_index> order;
+        order.reserve(storage->index.size());
+
+        // Algorytm Kahna, order służy jednocześnie za kolejkę.
+        for (node_index i = 0; i < nodes.size(); i++) {
+            if (!nodes[i].record)
+                continue;
+            cnt_waiting[i] = nodes[i].parents.size();
+            if (cnt_waiting[i] == 0)
+                order.push_back(i);
+        }
+        for (size_t i = 0; i < order.size(); i++)
+            for (const Edge &edge : nodes[order[i]].children)
+                if (--cnt_waiting[edge.node] == 0)
+                    order.push_back(edge.node);
+
+        if (order.size() != storage->index.size())
+            throw CitationCycle();
+
+        std::vector<id_type> ids;
+        ids.reserve(order.size());
+        for (node_index node : order)
+            ids.push_back(nodes[node].record->id);
+        return ids;
+    }
+
+    // Zwraca pamięć zajmowaną przez graf z podziałem na części. Czas liniowy względem liczby węzłów.
+    MemoryStats memory_stats() const noexcept {
+        const NodeArena &nodes = storage->nodes;
+        MemoryStats stats{};
+        stats.payload = storage->index.size() * sizeof(Record);
+        stats.nodes = nodes.bytes() - stats.payload;
+        stats.index = storage->index.bytes();
+        for (node_index i = 0; i < nodes.size(); i++)
+            stats.edges += nodes[i].children.heap_bytes() + nodes[i].parents.heap_bytes();
+        return stats;
+    }
+
+    /**
+     * Buduje graf od nowa w zwartej postaci: węzły dostają kolejne numery w kolejności przechodzenia wszerz
+     * od źródła (sąsiedzi leżą blisko siebie w pamięci), znikają wolne sloty, a listy sąsiadów i indeks
+     * mają rozmiar dopasowany do zawartości. Przydatne po wielu wywołaniach remove.
+     * Publikacje są przenoszone (albo kopiowane, jeśli przeniesienie może rzucić wyjątek), więc unieważnia
+     * referencje zwrócone przez operator[] i widoki. Na czas przebudowy potrzeba drugiej kopii grafu.
+     * Jeśli poleci wyjątek, graf pozostaje niezmieniony.
+     */
+    void compact() {
+        const NodeArena &nodes = storage->nodes;
+        std::vector<node_index> order;
+        order.reserve(storage->index.size());
+        bfs_nodes(storage->root, &Node::children, SIZE_MAX, [&order](node_index i, size_t) { order.push_back(i); });
+
+        std::vector<node_index> new_index(nodes.size(), NO_NODE);
+        for (node_index i = 0; i < order.size(); i++)
+            new_index[order[i]] = i;
+
+        // Wszystko, co może rzucić wyjątek, robimy przed przeniesieniem pierwszej publikacji.
+        auto compacted = std::make_unique<Storage>();
+        compacted->nodes.reserve(order.size());
+        compacted->index.reserve(order.size());
+        for (node_index old_node : order) {
+            Node &node = compacted->nodes[compacted->nodes.allocate()];
+            const Node &old = nodes[old_node];
+            node.children.reserve(old.children.size());
+            node.parents.reserve(old.parents.size());
+            // Kolejność na listach się nie zmienia, więc pozycje krawędzi odwrotnych pozostają aktualne.
+            for (const Edge &edge : old.children)
+                node.children.push_back({new_index[edge.node], edge.back});
+            for (const Edge &edge : old.parents)
+                node.parents.push_back({new_index[edge.node], edge.back});
+            node.creation_order = old.creation_order;
+            node.hash_tag = old.hash_tag;
+        }
+
+        for (node_index i = 0; i < order.size(); i++)
+            compacted->nodes[i].record.emplace(std::move_if_noexcept(*storage->nodes[order[i]].record));
+        for (node_index i = 0; i < order.size(); i++) {
+            const Node &node = compacted->nodes[i];
+            compacted->index.insert_at(compacted->index.probe(node.record->id, node.hash_tag, compacted->nodes),
+                                       i, node.hash_tag);
+        }
+        compacted->root = new_index[storage->root];
+        compacted->cnt_created = storage->cnt_created;
+        compacted->may_have_cycles = storage->may_have_cycles;
+        storage.swap(compacted);
     }
 };
 
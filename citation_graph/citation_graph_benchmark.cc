@@ -0,0 +1,207 @@
+#include "citation_graph.h"
+#include "citation_graph_file.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Benchmark na dużym grafie: ./citation_graph_benchmark [liczba_publikacji], domyślnie 10M.
+
+class Publication {
+public:
+  typedef uint64_t id_type;
+  Publication(id_type const &_id) : id(_id) {
+  }
+  id_type get_id() const noexcept {
+    return id;
+  }
+private:
+  id_type id;
+};
+
+class Timer {
+public:
+  explicit Timer(std::string _name) : name(std::move(_name)), start(std::chrono::steady_clock::now()) {
+  }
+  ~Timer() {
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << name << ": " << elapsed.count() << " s" << std::endl;
+  }
+private:
+  std::string name;
+  std::chrono::steady_clock::time_point start;
+};
+
+int main(int argc, char *argv[]) {
+  uint64_t const cnt_publications = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 10'000'000;
+  std::mt19937_64 rng(2020);
+  auto random_publication = [&rng](uint64_t cnt) { return rng() % cnt; };
+
+  std::vector<CitationGraph<Publication>::Citations> records;
+  records.reserve(cnt_publications);
+  for (uint64_t id = 1; id < cnt_publications; id++) {
+    std::vector<Publication::id_type> parents;
+    for (uint64_t i = 1 + rng() % 3; i > 0; i--)
+      parents.push_back(random_publication(id));
+    records.emplace_back(id, std::move(parents));
+  }
+
+  CitationGraph<Publication> graph(0);
+  {
+    Timer timer("create");
+    for (auto const &record : records)
+      graph.create(record.first, record.second);
+  }
+
+  {
+    CitationGraph<Publication> loaded(0);
+    Timer timer("create_all");
+    loaded.create_all(records);
+  }
+  records.clear();
+  records.shrink_to_fit();
+
+  {
+    Timer timer("add_citation");
+    for (uint64_t i = 0; i < cnt_publications / 10; i++) {
+      uint64_t parent = random_publication(cnt_publications - 1);
+      graph.add_citation(parent + 1 + random_publication(cnt_publications - parent - 1), parent);
+    }
+  }
+
+  uint64_t checksum = 0;
+  {
+    Timer timer("exists");
+    for (uint64_t i = 0; i < cnt_publications; i++)
+      checksum += graph.exists(random_publication(2 * cnt_publications));
+  }
+
+  {
+    Timer timer("get_children + get_parents");
+    for (uint64_t i = 0; i < cnt_publications; i++) {
+      uint64_t id = random_publication(cnt_publications);
+      checksum += graph.get_children(id).size() + graph.get_parents(id).size();
+    }
+  }
+
+  {
+    Timer timer("children_view + parents_view");
+    for (uint64_t i = 0; i < cnt_publications; i++) {
+      uint64_t id = random_publication(cnt_publications);
+      for (Publication::id_type const &child : graph.children_view(id))
+        checksum += child & 1;
+      for (Publication::id_type const &parent : graph.parents_view(id))
+        checksum += parent & 1;
+    }
+  }
+
+  {
+    Timer timer("count_children + count_parents");
+    for (uint64_t i = 0; i < cnt_publications; i++) {
+      uint64_t id = random_publication(cnt_publications);
+      checksum += graph.count_children(id) + graph.count_parents(id);
+    }
+  }
+
+  {
+    Timer timer("count_descendants (1 thread)");
+    checksum += graph.count_descendants(0);
+  }
+
+  {
+    unsigned cnt_threads = std::max(2u, std::thread::hardware_concurrency());
+    Timer timer("count_descendants (" + std::to_string(cnt_threads) + " threads)");
+    checksum += graph.count_descendants(0, cnt_threads);
+  }
+
+  {
+    Timer timer("k_hop (k = 2) of 1000 publications");
+    for (uint64_t i = 0; i < 1000; i++)
+      checksum += graph.k_hop(random_publication(cnt_publications), 2).size();
+  }
+
+  {
+    Timer timer("topological_order");
+    checksum += graph.topological_order().size();
+  }
+
+  std::string const file_path = "citation_graph_benchmark.graph";
+  {
+    Timer timer("MappedCitationGraph::save");
+    MappedCitationGraph<Publication>::save(graph, file_path);
+  }
+
+  {
+    std::optional<MappedCitationGraph<Publication>> mapped;
+    {
+      Timer timer("MappedCitationGraph (open)");
+      mapped.emplace(file_path);
+    }
+    {
+      Timer timer("MappedCitationGraph get_children + get_parents");
+      for (uint64_t i = 0; i < cnt_publications; i++) {
+        uint64_t id = random_publication(cnt_publications);
+        checksum += mapped->get_children(id).size() + mapped->get_parents(id).size();
+      }
+    }
+    {
+      Timer timer("MappedCitationGraph create + remove (overlay)");
+      for (uint64_t i = 0; i < cnt_publications / 100; i++) {
+        uint64_t parent = random_publication(cnt_publications);
+        mapped->create(cnt_publications + i, {mapped->exists(parent) ? parent : 0});
+        uint64_t id = 1 + random_publication(cnt_publications - 1);
+        if (mapped->exists(id))
+          mapped->remove(id);
+      }
+    }
+    {
+      Timer timer("MappedCitationGraph::compact");
+      mapped->compact();
+    }
+  }
+  std::remove(file_path.c_str());
+
+  {
+    Timer timer("remove");
+    for (uint64_t i = 0; i < 100; i++) {
+      uint64_t id = 1 + random_publication(cnt_publications - 1);
+      if (graph.exists(id))
+        graph.remove(id);
+    }
+  }
+
+  auto print_memory = [](char const *name, CitationGraph<Publication>::MemoryStats const &stats) {
+    std::cout << name << ": nodes " << stats.nodes << " B, edges " << stats.edges << " B, index " << stats.index
+              << " B, payload " << stats.payload << " B, total " << stats.total() << " B" << std::endl;
+  };
+  {
+    Timer timer("remove (10% of publications)");
+    for (uint64_t i = 0; i < cnt_publications / 10; i++) {
+      uint64_t id = 1 + random_publication(cnt_publications - 1);
+      if (graph.exists(id))
+        graph.remove(id);
+    }
+  }
+  print_memory("memory_stats", graph.memory_stats());
+
+  {
+    Timer timer("compact");
+    graph.compact();
+  }
+  print_memory("memory_stats after compact", graph.memory_stats());
+
+  {
+    Timer timer("count_descendants after compact");
+    checksum += graph.count_descendants(0);
+  }
+
+  std::cout << "checksum: " << checksum << std::endl;
+}
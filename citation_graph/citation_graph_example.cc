@@ -1,6 +1,11 @@
 #include "citation_graph.h"
+#include "citation_graph_file.h"
+#include "concurrent_citation_graph.h"
 
+#include <algorithm>
 #include <cassert>
+#include <cstdint>
+#include <cstdio>
 #include <exception>
 #include <iostream>
 #include <string>
@@ -18,6 +23,255 @@ private:
   id_type id;
 };
 
+// MappedCitationGraph wymaga publikacji, które da się skopiować bajt po bajcie.
+class NumberedPublication {
+public:
+  typedef uint64_t id_type;
+  NumberedPublication(id_type const &_id) : id(_id) {
+  }
+  id_type get_id() const noexcept {
+    return id;
+  }
+  int citations_read = 0;
+private:
+  id_type id;
+};
+
+template <class Id>
+bool same_ids(std::vector<Id> ids, std::vector<Id> expected) {
+  std::sort(ids.begin(), ids.end());
+  std::sort(expected.begin(), expected.end());
+  return ids == expected;
+}
+
+template <class Id>
+bool before(std::vector<Id> const &order, Id const &first, Id const &second) {
+  return std::find(order.begin(), order.end(), first) < std::find(order.begin(), order.end(), second);
+}
+
+// Źródło root cytowane przez A i B, C cytuje A i B, D cytuje C.
+CitationGraph<Publication> diamond() {
+  CitationGraph<Publication> gen("root");
+  typedef CitationGraph<Publication>::Citations Citations;
+  gen.create_all(std::vector<Citations>{{"A", {"root"}}, {"B", {"root"}}, {"C", {"A", "B"}}, {"D", {"C"}}});
+  return gen;
+}
+
+void batch_loading() {
+  CitationGraph<Publication> gen = diamond();
+  assert(same_ids(gen.get_children("root"), {"A", "B"}));
+  assert(same_ids(gen.get_parents("C"), {"A", "B"}));
+  assert(gen.get_children("D").empty());
+
+  // Wszystko albo nic: rekord cytujący nieistniejącą publikację wycofuje cały wsad.
+  typedef CitationGraph<Publication>::Citations Citations;
+  bool thrown = false;
+  try {
+    gen.create_all(std::vector<Citations>{{"E", {"D"}}, {"F", {"nowhere"}}});
+  }
+  catch (PublicationNotFound &) {
+    thrown = true;
+  }
+  assert(thrown);
+  assert(!gen.exists("E"));
+  assert(gen.get_children("D").empty());
+  thrown = false;
+  try {
+    gen.create_all(std::vector<Citations>{{"E", {"D"}}, {"A", {"E"}}});
+  }
+  catch (PublicationAlreadyCreated &) {
+    thrown = true;
+  }
+  assert(thrown);
+  assert(!gen.exists("E"));
+
+  // Rekord może cytować publikacje utworzone przez wcześniejsze rekordy.
+  std::vector<Citations> records = {{"E", {"D"}}, {"F", {"E", "A"}}};
+  gen.create_all(records.begin(), records.end());
+  assert(same_ids(gen.get_parents("F"), {"E", "A"}));
+  assert(gen.get_children("E") == std::vector<std::string>{"F"});
+}
+
+void traversals() {
+  CitationGraph<Publication> gen = diamond();
+  assert(gen.count_descendants("root") == 4);
+  assert(gen.count_descendants("root", 2) == 4);
+  assert(gen.count_ancestors("D") == 4);
+  assert(gen.count_descendants("D") == 0);
+
+  std::vector<std::string> hops = gen.k_hop("root", 1);
+  assert(same_ids(hops, {"A", "B"}));
+  hops = gen.k_hop("root", 2);
+  assert(hops.size() == 3 && hops.back() == "C");
+  assert(gen.k_hop("root", 10).size() == 4);
+  assert(gen.k_hop("D", 0).empty());
+  assert(same_ids(gen.k_hop("D", 2, CitationGraph<Publication>::Direction::parents), {"C", "A", "B"}));
+
+  std::vector<std::string> order = gen.topological_order();
+  assert(order.size() == 5 && order.front() == "root");
+  assert(before(order, std::string("A"), std::string("C")));
+  assert(before(order, std::string("B"), std::string("C")));
+  assert(before(order, std::string("C"), std::string("D")));
+
+  size_t cnt_visited = 0;
+  gen.dfs("root", [&cnt_visited](Publication const &) { cnt_visited++; });
+  assert(cnt_visited == 5);
+  size_t max_depth = 0;
+  gen.bfs("root", [&max_depth](Publication const &, size_t depth) { max_depth = std::max(max_depth, depth); });
+  assert(max_depth == 3);
+
+  gen.add_citation("A", "D");
+  bool thrown = false;
+  try {
+    gen.topological_order();
+  }
+  catch (CitationCycle &) {
+    thrown = true;
+  }
+  assert(thrown);
+  assert(gen.count_descendants("D") == 2);
+}
+
+void neighbour_views() {
+  CitationGraph<Publication> gen = diamond();
+  assert(gen.count_children("root") == 2);
+  assert(gen.count_parents("C") == 2);
+  assert(gen.count_children("D") == 0);
+
+  CitationGraph<Publication>::NeighbourView children = gen.children_view("root");
+  assert(children.size() == 2);
+  assert(same_ids(std::vector<std::string>(children.begin(), children.end()), {"A", "B"}));
+  CitationGraph<Publication>::NeighbourView parents = gen.parents_view("C");
+  assert(same_ids(std::vector<std::string>(parents.begin(), parents.end()), {"A", "B"}));
+  assert(gen.parents_view("root").empty());
+}
+
+void compaction() {
+  CitationGraph<Publication> gen = diamond();
+  for (int i = 0; i < 100; i++)
+    gen.create("E" + std::to_string(i), "D");
+  size_t before_removal = gen.memory_stats().total();
+  gen.remove("D");
+  gen.remove("B");
+  gen.compact();
+  assert(gen.memory_stats().total() < before_removal);
+  assert(gen.get_children("root") == std::vector<std::string>{"A"});
+  assert(gen.get_parents("C") == std::vector<std::string>{"A"});
+  assert(!gen.exists("D") && !gen.exists("E0"));
+  assert(gen.count_descendants("root") == 2);
+  assert(gen["C"].get_id() == "C");
+}
+
+void cycle_removal() {
+  CitationGraph<Publication> gen = diamond();
+  gen.add_citation("A", "D");
+  // Cykl A -> C -> D -> A jest wciąż osiągalny ze źródła, więc usunięcie B go nie rusza.
+  gen.remove("B");
+  assert(gen.exists("A") && gen.exists("C") && gen.exists("D"));
+  assert(same_ids(gen.get_parents("A"), {"root", "D"}));
+  // Cykl X -> Y -> X odcięty od źródła znika razem z P.
+  gen.create("P", "root");
+  gen.create("X", "P");
+  gen.create("Y", "X");
+  gen.add_citation("X", "Y");
+  gen.remove("P");
+  assert(!gen.exists("X") && !gen.exists("Y"));
+  // Usunięcie A odcina cały cykl.
+  gen.remove("A");
+  assert(!gen.exists("C") && !gen.exists("D"));
+  assert(gen.get_children("root").empty());
+}
+
+void mapped_graph() {
+  std::string const path = "citation_graph_example.graph";
+  CitationGraph<NumberedPublication> gen(0);
+  gen.create(1, 0);
+  gen.create(2, 0);
+  gen.create(3, std::vector<uint64_t>{1, 2});
+  gen[3].citations_read = 7;
+  MappedCitationGraph<NumberedPublication>::save(gen, path);
+
+  MappedCitationGraph<NumberedPublication> mapped(path);
+  assert(mapped.get_root_id() == 0);
+  assert(same_ids(mapped.get_children(0), {1, 2}));
+  assert(same_ids(mapped.get_parents(3), {1, 2}));
+  assert(mapped[3].citations_read == 7);
+
+  // Zmiany trafiają do nakładki, a po compact do pliku.
+  mapped.create(4, 3);
+  mapped.add_citation(4, 1);
+  mapped.remove(2);
+  assert(!mapped.exists(2));
+  assert(mapped.get_parents(3) == std::vector<uint64_t>{1});
+  mapped.compact();
+  MappedCitationGraph<NumberedPublication> reopened(path);
+  assert(!reopened.exists(2));
+  assert(same_ids(reopened.get_parents(4), {1, 3}));
+  assert(reopened[3].citations_read == 7);
+  // Cytowanie między węzłami z pliku zamyka cykl 3 -> 4 -> 3, który znika razem z 1.
+  reopened.add_citation(3, 4);
+  reopened.remove(1);
+  assert(!reopened.exists(3) && !reopened.exists(4));
+  assert(reopened.get_children(0).empty());
+
+  // Plik, który nie jest grafem, jest odrzucany.
+  std::FILE *file = std::fopen(path.c_str(), "wb");
+  std::fputs("not a graph", file);
+  std::fclose(file);
+  bool thrown = false;
+  try {
+    MappedCitationGraph<NumberedPublication> broken(path);
+  }
+  catch (GraphFileError &) {
+    thrown = true;
+  }
+  assert(thrown);
+  std::remove(path.c_str());
+}
+
+void concurrent_graph() {
+  ConcurrentCitationGraph<Publication> gen("root");
+  gen.create("A", "root");
+  gen.create("B", "A");
+  ConcurrentCitationGraph<Publication>::Snapshot before_changes = gen.snapshot();
+
+  gen.create("C", std::vector<std::string>{"A", "B"});
+  gen.add_citation("A", "C");
+  assert(same_ids(gen.get_parents("A"), {"root", "C"}));
+  assert(same_ids(gen.get_children("A"), {"B", "C"}));
+  bool thrown = false;
+  try {
+    gen.create("C", "root");
+  }
+  catch (PublicationAlreadyCreated &) {
+    thrown = true;
+  }
+  assert(thrown);
+
+  // Migawka widzi graf z chwili jej zrobienia.
+  assert(!before_changes.exists("C"));
+  assert(before_changes.get_children("A") == std::vector<std::string>{"B"});
+  assert(before_changes.get_parents("A") == std::vector<std::string>{"root"});
+  assert(before_changes.get_root_id() == "root");
+
+  // Cykl A -> C -> A jest wciąż osiągalny ze źródła, więc usunięcie B go nie rusza.
+  gen.remove("B");
+  assert(gen.exists("A") && gen.exists("C"));
+  assert(gen.get_parents("C") == std::vector<std::string>{"A"});
+
+  // Cykl X -> Y -> X odcięty od źródła znika razem z P.
+  gen.create("P", "root");
+  gen.create("X", "P");
+  gen.create("Y", "X");
+  gen.add_citation("X", "Y");
+  gen.remove("P");
+  assert(!gen.exists("P") && !gen.exists("X") && !gen.exists("Y"));
+  gen.remove("A");
+  assert(!gen.exists("B") && !gen.exists("C"));
+  assert(gen.get_children("root").empty());
+  assert(before_changes.exists("A") && before_changes.exists("B"));
+}
+
 int main() {
   CitationGraph<Publication> gen("Goto Considered Harmful");
   Publication::id_type const id1 = gen.get_root_id(); // Czy to jest noexcept?
@@ -66,4 +320,12 @@ int main() {
   catch (std::exception &e) {
     std::cout << e.what() << std::endl;
   }
+
+  batch_loading();
+  traversals();
+  neighbour_views();
+  compaction();
+  cycle_removal();
+  mapped_graph();
+  concurrent_graph();
 }
@@ -0,0 +1,681 @@
+#ifndef CITATION_GRAPH_FILE_H
+#define CITATION_GRAPH_FILE_H
+
+#include "citation_graph.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <vector>
+#include <string>
+#include <optional>
+#include <unordered_map>
+#include <algorithm>
+#include <numeric>
+#include <fstream>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+#include <initializer_list>
+
+class GraphFileError : public std::exception {
+    const char* what() const noexcept override {
+        return "GraphFileError";
+    }
+};
+
+/**
+ * Nagłówek pliku grafu cytowań. Za nim, każda od granicy 64 bajtów, leżą sekcje:
+ *   ids              - identyfikatory posortowane rosnąco; numer węzła to pozycja w tej tablicy,
+ *   children_offsets - cnt_nodes + 1 liczb uint64_t: dzieci węzła i to children[children_offsets[i] ..
+ *                      children_offsets[i + 1]),
+ *   children         - cnt_edges numerów węzłów (uint32_t),
+ *   parents_offsets, parents - rodzice w tym samym układzie (CSR),
+ *   ranks            - cnt_nodes numerów (uint32_t) mniejszych od cnt_nodes; w grafie bez cykli każda
+ *                      krawędź prowadzi od rodzica o mniejszym numerze do dziecka o większym,
+ *   payload          - cnt_nodes obiektów Publication w kolejności ids.
+ * Liczby są zapisane w porządku bajtów maszyny, która zapisała plik.
+ */
+struct GraphFileHeader {
+    static constexpr char MAGIC[8] = {'C', 'I', 'T', 'G', 'R', 'A', 'P', 'H'};
+    static constexpr uint32_t FORMAT_VERSION = 2;
+    static constexpr uint32_t FLAG_MAY_HAVE_CYCLES = 1;
+    static constexpr uint64_t SECTION_ALIGNMENT = 64;
+
+    char magic[8];
+    uint32_t format_version;
+    uint32_t flags;
+    uint32_t id_size;
+    uint32_t publication_size;
+    uint64_t cnt_nodes;
+    uint64_t cnt_edges;
+    uint64_t root;
+    uint64_t ids;
+    uint64_t children_offsets;
+    uint64_t children;
+    uint64_t parents_offsets;
+    uint64_t parents;
+    uint64_t ranks;
+    uint64_t payload;
+    uint64_t file_size;
+};
+
+/**
+ * Graf cytowań przechowywany w pliku. Plik jest odwzorowany w pamięć. Otwarcie czyta identyfikatory
+ * i krawędzie, żeby sprawdzić poprawność grafu, a strony z publikacjami są wczytywane dopiero przy dostępie.
+ * Plik jest otwierany tylko do odczytu, a odwzorowanie jest prywatne: zmiany publikacji przez operator[]
+ * nie trafiają do pliku aż do compact.
+ * Zmiany grafu (create, add_citation, remove) trafiają do nakładki w pamięci; compact zapisuje scalony graf
+ * z powrotem do pliku i opróżnia nakładkę.
+ *
+ * Wymaga trywialnie kopiowalnych Publication i id_type, id_type musi mieć operator< oraz std::hash.
+ */
+template <class Publication> class MappedCitationGraph {
+    static_assert(std::is_trivially_copyable_v<Publication>, "Publication must be trivially copyable");
+    static_assert(std::is_trivially_copyable_v<typename Publication::id_type>, "id_type must be trivially copyable");
+
+private:
+    using id_type = typename Publication::id_type;
+    // Węzły z pliku mają numery [0, cnt_base), dołożone w nakładce - kolejne.
+    using node_index = uint32_t;
+    static constexpr node_index NO_NODE = UINT32_MAX;
+
+    /// Odwzorowanie pliku w pamięć, zwalniane w destruktorze.
+    class Mapping {
+    private:
+        void *data = nullptr;
+        size_t size = 0;
+
+    public:
+        Mapping() noexcept = default;
+
+        Mapping(void *data, size_t size) noexcept : data(data), size(size) {}
+
+        Mapping(Mapping &&other) noexcept
+                : data(std::exchange(other.data, nullptr)), size(std::exchange(other.size, 0)) {}
+
+        Mapping& operator=(Mapping &&other) noexcept {
+            std::swap(data, other.data);
+            std::swap(size, other.size);
+            return *this;
+        }
+
+        ~Mapping() {
+            if (data != nullptr)
+                munmap(data, size);
+        }
+
+        char* bytes() const noexcept {
+            return static_cast<char *>(data);
+        }
+    };
+
+    struct AddedNode {
+        id_type id;
+        std::optional<Publication> publication; // Pusta po usunięciu.
+    };
+
+    using ExtraEdges = std::unordered_map<node_index, std::vector<node_index>>;
+
+    std::string path;
+    Mapping mapping;
+    node_index cnt_base = 0;
+    node_index root = 0;
+    const id_type *base_ids = nullptr;
+    const uint64_t *base_children_offsets = nullptr;
+    const node_index *base_children = nullptr;
+    const uint64_t *base_parents_offsets = nullptr;
+    const node_index *base_parents = nullptr;
+    const node_index *base_ranks = nullptr;
+    Publication *payload = nullptr;
+
+    // Nakładka ze zmianami od ostatniego zapisu. Krawędzie dołożone przez create i add_citation są
+    // w extra_*; krawędzie z pliku znikają razem z usuniętymi węzłami.
+    std::vector<bool> removed_base;
+    std::vector<AddedNode> added;
+    std::unordered_map<id_type, node_index> added_index;
+    ExtraEdges extra_children;
+    ExtraEdges extra_parents;
+    bool may_have_cycles = false;
+
+    template <class T> static const T* section(const char *bytes, uint64_t offset) noexcept {
+        return reinterpret_cast<const T *>(bytes + offset);
+    }
+
+    static uint64_t align(uint64_t offset) noexcept {
+        uint64_t alignment = GraphFileHeader::SECTION_ALIGNMENT;
+        return (offset + alignment - 1) / alignment * alignment;
+    }
+
+    /**
+     * Numeruje węzły grafu w układzie CSR w kolejności algorytmu Kahna, więc krawędzie między
+     * ponumerowanymi tak węzłami prowadzą od mniejszego numeru do większego. Węzły, których algorytm
+     * nie przetworzy (na cyklach i za nimi), dostają kolejne numery na końcu. Zwraca, czy graf jest acykliczny.
+     */
+    static bool topological_ranks(uint64_t n, const uint64_t *children_offsets, const node_index *children,
+                                  const uint64_t *parents_offsets, std::vector<node_index> &ranks) {
+        std::vector<uint64_t> cnt_waiting(n);
+        std::vector<node_index> queue;
+        for (node_index i = 0; i < n; i++) {
+            cnt_waiting[i] = parents_offsets[i + 1] - parents_offsets[i];
+            if (cnt_waiting[i] == 0)
+                queue.push_back(i);
+        }
+        for (size_t i = 0; i < queue.size(); i++)
+            for (uint64_t e = children_offsets[queue[i]]; e < children_offsets[queue[i] + 1]; e++)
+                if (--cnt_waiting[children[e]] == 0)
+                    queue.push_back(children[e]);
+
+        bool acyclic = queue.size() == n;
+        for (node_index i = 0; i < n; i++)
+            if (cnt_waiting[i] > 0)
+                queue.push_back(i);
+        ranks.assign(n, 0);
+        for (size_t i = 0; i < n; i++)
+            ranks[queue[i]] = i;
+        return acyclic;
+    }
+
+    /// Czy sekcje ids, CSR i ranks z pliku (o poprawnych już granicach) tworzą graf, jaki zapisuje write_file.
+    static bool is_valid_graph(const char *bytes, GraphFileHeader const &header) {
+        uint64_t n = header.cnt_nodes, m = header.cnt_edges;
+        const id_type *ids = section<id_type>(bytes, header.ids);
+        const uint64_t *children_offsets = section<uint64_t>(bytes, header.children_offsets);
+        const node_index *children = section<node_index>(bytes, header.children);
+        const uint64_t *parents_offsets = section<uint64_t>(bytes, header.parents_offsets);
+        const node_index *parents = section<node_index>(bytes, header.parents);
+        const node_index *ranks = section<node_index>(bytes, header.ranks);
+
+        for (uint64_t i = 1; i < n; i++)
+            if (!(ids[i - 1] < ids[i]))
+                return false;
+        for (const uint64_t *offsets : {children_offsets, parents_offsets}) {
+            if (offsets[0] != 0 || offsets[n] != m)
+                return false;
+            for (uint64_t i = 0; i < n; i++)
+                if (offsets[i] > offsets[i + 1])
+                    return false;
+        }
+        for (uint64_t e = 0; e < m; e++)
+            if (children[e] >= n)
+                return false;
+
+        // Rodzice muszą być odwróceniem dzieci w kolejności, w jakiej tworzy je write_file.
+        std::vector<uint64_t> next(parents_offsets, parents_offsets + n);
+        for (node_index i = 0; i < n; i++)
+            for (uint64_t e = children_offsets[i]; e < children_offsets[i + 1]; e++) {
+                node_index child = children[e];
+                if (next[child] == parents_offsets[child + 1] || parents[next[child]++] != i)
+                    return false;
+            }
+
+        for (uint64_t i = 0; i < n; i++)
+            if (ranks[i] >= n)
+                return false;
+        if (header.flags & GraphFileHeader::FLAG_MAY_HAVE_CYCLES)
+            return true;
+        // Numery rosnące wzdłuż każdej krawędzi dowodzą też, że graf nie ma cykli.
+        for (node_index i = 0; i < n; i++)
+            for (uint64_t e = children_offsets[i]; e < children_offsets[i + 1]; e++)
+                if (ranks[i] >= ranks[children[e]])
+                    return false;
+        return true;
+    }
+
+    /// Odwzorowuje plik path i zastępuje nim dotychczasowy stan (także nakładkę).
+    void map_file() {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            throw GraphFileError();
+        struct stat status{};
+        if (fstat(fd, &status) != 0 || static_cast<uint64_t>(status.st_size) < sizeof(GraphFileHeader)) {
+            ::close(fd);
+            throw GraphFileError();
+        }
+        void *data = mmap(nullptr, status.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (data == MAP_FAILED)
+            throw GraphFileError();
+        Mapping new_mapping(data, status.st_size);
+
+        GraphFileHeader header;
+        std::memcpy(&header, new_mapping.bytes(), sizeof(header));
+        uint64_t n = header.cnt_nodes, m = header.cnt_edges;
+        auto fits = [&](uint64_t offset, uint64_t size) {
+            return offset % GraphFileHeader::SECTION_ALIGNMENT == 0 && offset <= header.file_size &&
+                   size <= header.file_size - offset;
+        };
+        if (std::memcmp(header.magic, GraphFileHeader::MAGIC, sizeof(header.magic)) != 0 ||
+            header.format_version != GraphFileHeader::FORMAT_VERSION || header.id_size != sizeof(id_type) ||
+            header.publication_size != sizeof(Publication) || header.file_size != uint64_t(status.st_size) ||
+            n == 0 || n >= NO_NODE || m >= (uint64_t(1) << 40) || header.root >= n ||
+            !fits(header.ids, n * sizeof(id_type)) ||
+            !fits(header.children_offsets, (n + 1) * sizeof(uint64_t)) ||
+            !fits(header.children, m * sizeof(node_index)) ||
+            !fits(header.parents_offsets, (n + 1) * sizeof(uint64_t)) ||
+            !fits(header.parents, m * sizeof(node_index)) || !fits(header.ranks, n * sizeof(node_index)) ||
+            !fits(header.payload, n * sizeof(Publication)) || !is_valid_graph(new_mapping.bytes(), header))
+            throw GraphFileError();
+
+        mapping = std::move(new_mapping);
+        const char *bytes = mapping.bytes();
+        cnt_base = n;
+        root = header.root;
+        base_ids = section<id_type>(bytes, header.ids);
+        base_children_offsets = section<uint64_t>(bytes, header.children_offsets);
+        base_children = section<node_index>(bytes, header.children);
+        base_parents_offsets = section<uint64_t>(bytes, header.parents_offsets);
+        base_parents = section<node_index>(bytes, header.parents);
+        base_ranks = section<node_index>(bytes, header.ranks);
+        payload = reinterpret_cast<Publication *>(mapping.bytes() + header.payload);
+
+        removed_base.clear();
+        added.clear();
+        added_index.clear();
+        extra_children.clear();
+        extra_parents.clear();
+        may_have_cycles = header.flags & GraphFileHeader::FLAG_MAY_HAVE_CYCLES;
+    }
+
+    /**
+     * Zapisuje graf do pliku path: ids posortowane rosnąco, publications[i] to publikacja o id ids[i],
+     * dzieci węzła i to children[children_offsets[i] .. children_offsets[i + 1]). Plik powstaje obok
+     * i zastępuje path dopiero, gdy jest kompletny.
+     */
+    static void write_file(std::string const &path, std::vector<id_type> const &ids,
+                           std::vector<const Publication *> const &publications,
+                           std::vector<uint64_t> const &children_offsets, std::vector<node_index> const &children,
+                           node_index root) {
+        uint64_t n = ids.size(), m = children.size();
+
+        // Odwrócenie CSR przez zliczanie.
+        std::vector<uint64_t> parents_offsets(n + 1, 0);
+        for (node_index child : children)
+            parents_offsets[child + 1]++;
+        std::partial_sum(parents_offsets.begin(), parents_offsets.end(), parents_offsets.begin());
+        std::vector<node_index> parents(m);
+        std::vector<uint64_t> next(parents_offsets.begin(), parents_offsets.end() - 1);
+        for (node_index i = 0; i < n; i++)
+            for (uint64_t e = children_offsets[i]; e < children_offsets[i + 1]; e++)
+                parents[next[children[e]]++] = i;
+
+        std::vector<node_index> ranks;
+        bool acyclic = topological_ranks(n, children_offsets.data(), children.data(), parents_offsets.data(), ranks);
+
+        GraphFileHeader header{};
+        std::memcpy(header.magic, GraphFileHeader::MAGIC, sizeof(header.magic));
+        header.format_version = GraphFileHeader::FORMAT_VERSION;
+        header.flags = acyclic ? 0 : GraphFileHeader::FLAG_MAY_HAVE_CYCLES;
+        header.id_size = sizeof(id_type);
+        header.publication_size = sizeof(Publication);
+        header.cnt_nodes = n;
+        header.cnt_edges = m;
+        header.root = root;
+        header.ids = align(sizeof(header));
+        header.children_offsets = align(header.ids + n * sizeof(id_type));
+        header.children = align(header.children_offsets + (n + 1) * sizeof(uint64_t));
+        header.parents_offsets = align(header.children + m * sizeof(node_index));
+        header.parents = align(header.parents_offsets + (n + 1) * sizeof(uint64_t));
+        header.ranks = align(header.parents + m * sizeof(node_index));
+        header.payload = align(header.ranks + n * sizeof(node_index));
+        header.file_size = header.payload + n * sizeof(Publication);
+
+        std::string tmp_path = path + ".tmp";
+        std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+        uint64_t position = 0;
+        auto write_at = [&](uint64_t offset, const void *data, uint64_t size) {
+            static const char zeros[GraphFileHeader::SECTION_ALIGNMENT] = {};
+            out.write(zeros, offset - position);
+            out.write(static_cast<const char *>(data), size);
+            position = offset + size;
+        };
+        write_at(0, &header, sizeof(header));
+        write_at(header.ids, ids.data(), n * sizeof(id_type));
+        write_at(header.children_offsets, children_offsets.data(), (n + 1) * sizeof(uint64_t));
+        write_at(header.children, children.data(), m * sizeof(node_index));
+        write_at(header.parents_offsets, parents_offsets.data(), (n + 1) * sizeof(uint64_t));
+        write_at(header.parents, parents.data(), m * sizeof(node_index));
+        write_at(header.ranks, ranks.data(), n * sizeof(node_index));
+        for (uint64_t i = 0; i < n; i++)
+            write_at(header.payload + i * sizeof(Publication), publications[i], sizeof(Publication));
+        out.close();
+
+        if (!out || std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+            std::remove(tmp_path.c_str());
+            throw GraphFileError();
+        }
+    }
+
+    bool alive(node_index i) const noexcept {
+        if (i < cnt_base)
+            return removed_base.empty() || !removed_base[i];
+        return added[i - cnt_base].publication.has_value();
+    }
+
+    /// Numer węzła w porządku, w którym krawędzie grafu bez cykli prowadzą od mniejszego do większego,
+    /// tak jak creation_order w CitationGraph. Węzły nakładki są młodsze od wszystkich węzłów z pliku.
+    node_index rank(node_index i) const noexcept {
+        return i < cnt_base ? base_ranks[i] : i;
+    }
+
+    const id_type& id_of(node_index i) const noexcept {
+        return i < cnt_base ? base_ids[i] : added[i - cnt_base].id;
+    }
+
+    Publication& publication(node_index i) const noexcept {
+        return i < cnt_base ? payload[i] : const_cast<Publication &>(*added[i - cnt_base].publication);
+    }
+
+    node_index find(id_type const &id) const {
+        auto found = added_index.find(id);
+        if (found != added_index.end())
+            return found->second;
+
+        const id_type *position = std::lower_bound(base_ids, base_ids + cnt_base, id);
+        if (position == base_ids + cnt_base || id < *position)
+            return NO_NODE;
+        node_index i = position - base_ids;
+        return alive(i) ? i : NO_NODE;
+    }
+
+    /// Woła visit(sąsiad) dla żywych sąsiadów węzła i: najpierw z pliku, potem z nakładki.
+    template <class Visitor>
+    void for_each_neighbour(node_index i, const uint64_t *offsets, const node_index *targets,
+                            const ExtraEdges &extra, Visitor &&visit) const {
+        if (i < cnt_base)
+            for (uint64_t e = offsets[i]; e < offsets[i + 1]; e++)
+                if (alive(targets[e]))
+                    visit(targets[e]);
+
+        auto found = extra.find(i);
+        if (found != extra.end())
+            for (node_index neighbour : found->second)
+                visit(neighbour);
+    }
+
+    template <class Visitor>
+    void for_each_child(node_index i, Visitor &&visit) const {
+        for_each_neighbour(i, base_children_offsets, base_children, extra_children, visit);
+    }
+
+    template <class Visitor>
+    void for_each_parent(node_index i, Visitor &&visit) const {
+        for_each_neighbour(i, base_parents_offsets, base_parents, extra_parents, visit);
+    }
+
+    std::vector<id_type> get_ids(node_index i, bool children) const {
+        std::vector<id_type> ids;
+        auto push = [&](node_index neighbour) { ids.push_back(id_of(neighbour)); };
+        if (children)
+            for_each_child(i, push);
+        else
+            for_each_parent(i, push);
+        return ids;
+    }
+
+    bool is_linked(node_index parent, node_index child) const {
+        bool linked = false;
+        for_each_parent(child, [&](node_index neighbour) { linked |= neighbour == parent; });
+        return linked;
+    }
+
+    static void erase_edge(ExtraEdges &extra, node_index owner, node_index neighbour) noexcept {
+        auto found = extra.find(owner);
+        if (found == extra.end())
+            return;
+        std::vector<node_index> &list = found->second;
+        list.erase(std::remove(list.begin(), list.end(), neighbour), list.end());
+        if (list.empty())
+            extra.erase(found);
+    }
+
+    /// Usuwa węzeł z nakładki i z jej krawędzi; krawędzie z pliku znikają same, bo węzeł nie jest już żywy.
+    void release(node_index i) noexcept {
+        if (i < cnt_base) {
+            removed_base[i] = true;
+        } else {
+            added_index.erase(added[i - cnt_base].id);
+            added[i - cnt_base].publication.reset();
+        }
+
+        auto children = extra_children.find(i);
+        if (children != extra_children.end()) {
+            for (node_index child : children->second)
+                erase_edge(extra_parents, child, i);
+            extra_children.erase(children);
+        }
+        auto parents = extra_parents.find(i);
+        if (parents != extra_parents.end()) {
+            for (node_index parent : parents->second)
+                erase_edge(extra_children, parent, i);
+            extra_parents.erase(parents);
+        }
+    }
+
+    /// Węzły, które trzeba usunąć razem z to_remove; graf się przy tym nie zmienia.
+    std::vector<node_index> doomed_nodes(node_index to_remove) const {
+        std::vector<node_index> doomed = {to_remove};
+
+        if (!may_have_cycles) {
+            // Bez cykli węzeł jest osiągalny wtw, gdy ma rodzica - usuwamy te, którym nie zostanie żaden.
+            std::unordered_map<node_index, uint64_t> cnt_parents_left;
+            for (size_t next = 0; next < doomed.size(); next++) {
+                for_each_child(doomed[next], [&](node_index child) {
+                    if (child == root)
+                        return;
+                    auto found = cnt_parents_left.find(child);
+                    if (found == cnt_parents_left.end()) {
+                        uint64_t cnt_parents = 0;
+                        for_each_parent(child, [&](node_index) { cnt_parents++; });
+                        found = cnt_parents_left.emplace(child, cnt_parents).first;
+                    }
+                    if (--found->second == 0)
+                        doomed.push_back(child);
+                });
+            }
+            return doomed;
+        }
+
+        std::vector<bool> reachable(cnt_base + added.size());
+        std::vector<node_index> stack = {root};
+        reachable[root] = true;
+        reachable[to_remove] = true; // Nie przechodzimy przez usuwany węzeł.
+        while (!stack.empty()) {
+            node_index i = stack.back();
+            stack.pop_back();
+            for_each_child(i, [&](node_index child) {
+                if (!reachable[child]) {
+                    reachable[child] = true;
+                    stack.push_back(child);
+                }
+            });
+        }
+        for (node_index i = 0; i < reachable.size(); i++)
+            if (!reachable[i] && alive(i))
+                doomed.push_back(i);
+        return doomed;
+    }
+
+    node_index checkExistence(id_type const &id) const {
+        node_index i = find(id);
+        if (i == NO_NODE)
+            throw PublicationNotFound();
+        return i;
+    }
+
+public:
+    // Otwiera graf zapisany w pliku path. Zgłasza wyjątek GraphFileError, jeśli pliku nie da się odczytać
+    // albo nie jest on grafem zapisanym dla tych typów Publication i id_type.
+    explicit MappedCitationGraph(std::string path) : path(std::move(path)) {
+        map_file();
+    }
+
+    MappedCitationGraph(MappedCitationGraph &&other) = default;
+    MappedCitationGraph& operator=(MappedCitationGraph &&other) = default;
+
+    // Zapisuje graf do pliku path. Zgłasza wyjątek GraphFileError, jeśli zapis się nie powiedzie;
+    // poprzednia zawartość pliku zostaje wtedy nietknięta.
+    static void save(CitationGraph<Publication> const &graph, std::string const &path) {
+        // Każda publikacja jest osiągalna ze źródła, więc przejście wszerz odwiedza cały graf.
+        std::vector<std::pair<id_type, const Publication *>> nodes;
+        graph.bfs(graph.get_root_id(), [&nodes](Publication const &publication, size_t) {
+            nodes.emplace_back(publication.get_id(), &publication);
+        });
+        std::sort(nodes.begin(), nodes.end(), [](auto const &a, auto const &b) { return a.first < b.first; });
+
+        std::vector<id_type> ids;
+        std::vector<const Publication *> publications;
+        ids.reserve(nodes.size());
+        publications.reserve(nodes.size());
+        for (auto const &[id, publication] : nodes) {
+            ids.push_back(id);
+            publications.push_back(publication);
+        }
+        nodes.clear();
+        nodes.shrink_to_fit();
+        auto index_of = [&ids](id_type const &id) -> node_index {
+            return std::lower_bound(ids.begin(), ids.end(), id) - ids.begin();
+        };
+
+        std::vector<uint64_t> children_offsets = {0};
+        std::vector<node_index> children;
+        for (id_type const &id : ids) {
+            for (id_type const &child : graph.children_view(id))
+                children.push_back(index_of(child));
+            children_offsets.push_back(children.size());
+        }
+        write_file(path, ids, publications, children_offsets, children, index_of(graph.get_root_id()));
+    }
+
+    // Zapisuje graf razem z nakładką z powrotem do pliku, z którego go otwarto, i otwiera go od nowa.
+    // Unieważnia referencje zwrócone przez operator[]. Zgłasza wyjątek GraphFileError, jeśli zapis się
+    // nie powiedzie - graf pozostaje wtedy niezmieniony.
+    void compact() {
+        // Żywe węzły w kolejności id: węzły z pliku już są posortowane, dołożone sortujemy i scalamy.
+        std::vector<node_index> order, added_order;
+        for (node_index i = 0; i < cnt_base; i++)
+            if (alive(i))
+                order.push_back(i);
+        for (node_index i = cnt_base; i < cnt_base + added.size(); i++)
+            if (alive(i))
+                added_order.push_back(i);
+        auto by_id = [this](node_index a, node_index b) { return id_of(a) < id_of(b); };
+        std::sort(added_order.begin(), added_order.end(), by_id);
+        size_t cnt_alive_base = order.size();
+        order.insert(order.end(), added_order.begin(), added_order.end());
+        std::inplace_merge(order.begin(), order.begin() + cnt_alive_base, order.end(), by_id);
+
+        std::vector<node_index> new_index(cnt_base + added.size(), NO_NODE);
+        for (node_index i = 0; i < order.size(); i++)
+            new_index[order[i]] = i;
+
+        std::vector<id_type> ids;
+        std::vector<const Publication *> publications;
+        std::vector<uint64_t> children_offsets = {0};
+        std::vector<node_index> children;
+        ids.reserve(order.size());
+        publications.reserve(order.size());
+        for (node_index i : order) {
+            ids.push_back(id_of(i));
+            publications.push_back(&publication(i));
+            for_each_child(i, [&](node_index child) { children.push_back(new_index[child]); });
+            children_offsets.push_back(children.size());
+        }
+        write_file(path, ids, publications, children_offsets, children, new_index[root]);
+        map_file();
+    }
+
+    // Sprawdza, czy publikacja o podanym id istnieje.
+    bool exists(id_type const &id) const {
+        return find(id) != NO_NODE;
+    }
+
+    id_type get_root_id() const noexcept {
+        return id_of(root);
+    }
+
+    // Zwraca listę identyfikatorów publikacji cytujących publikację o podanym identyfikatorze.
+    // Zgłasza wyjątek PublicationNotFound, jeśli dana publikacja nie istnieje.
+    std::vector<id_type> get_children(id_type const &id) const {
+        return get_ids(checkExistence(id), true);
+    }
+
+    std::vector<id_type> get_parents(id_type const &id) const {
+        return get_ids(checkExistence(id), false);
+    }
+
+    // Zwraca referencję do obiektu reprezentującego publikację o podanym id. Zgłasza wyjątek PublicationNotFound,
+    // jeśli żądana publikacja nie istnieje
+    Publication& operator[](id_type const &id) const {
+        return publication(checkExistence(id));
+    }
+
+    void create(id_type const &id, id_type const &parent_id) {
+        create(id, std::vector<id_type> {parent_id});
+    }
+
+    void create(id_type const &id, std::vector<id_type> const &parent_ids) {
+        if (find(id) != NO_NODE)
+            throw PublicationAlreadyCreated();
+        if (parent_ids.empty())
+            throw PublicationNotFound();
+        std::vector<node_index> parents;
+        for (auto &parent_id : parent_ids)
+            parents.push_back(checkExistence(parent_id));
+        std::sort(parents.begin(), parents.end());
+        parents.erase(std::unique(parents.begin(), parents.end()), parents.end());
+
+        node_index new_node = cnt_base + added.size();
+        added.push_back({id, Publication(id)});
+        try {
+            added_index.emplace(id, new_node);
+            extra_parents[new_node] = parents;
+            for (node_index parent : parents)
+                extra_children[parent].push_back(new_node);
+        } catch (...) {
+            release(new_node);
+            added.pop_back();
+            throw;
+        }
+    }
+
+    // Dodaje nową krawędź w grafie cytowań. Zgłasza wyjątek PublicationNotFound,
+    // jeśli któraś z podanych publikacji nie istnieje.
+    void add_citation(id_type const &child_id, id_type const &parent_id) {
+        node_index child = checkExistence(child_id);
+        node_index parent = checkExistence(parent_id);
+        if (is_linked(parent, child))
+            return;
+
+        extra_children[parent].push_back(child);
+        try {
+            extra_parents[child].push_back(parent);
+        } catch (...) {
+            erase_edge(extra_children, parent, child);
+            throw;
+        }
+        if (rank(parent) >= rank(child))
+            may_have_cycles = true;
+    }
+
+    // Usuwa publikację o podanym identyfikatorze. Zgłasza wyjątek
+    // PublicationNotFound, jeśli żądana publikacja nie istnieje. Zgłasza wyjątek
+    // TriedToRemoveRoot przy próbie usunięcia pierwotnej publikacji.
+    // W wypadku rozspójnienia grafu, zachowujemy tylko spójną składową zawierającą źródło.
+    void remove(id_type const &id) {
+        node_index to_remove = checkExistence(id);
+        if (to_remove == root)
+            throw TriedToRemoveRoot();
+
+        removed_base.resize(cnt_base);
+        for (node_index i : doomed_nodes(to_remove))
+            release(i);
+    }
+};
+
+
+#endif //CITATION_GRAPH_FILE_H
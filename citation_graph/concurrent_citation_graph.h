@@ -0,0 +1,879 @@
+#ifndef CONCURRENT_CITATION_GRAPH_H
+#define CONCURRENT_CITATION_GRAPH_H
+
+#include "citation_graph.h"
+
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <functional>
+#include <algorithm>
+#include <type_traits>
+#include <cstdint>
+#include <cstring>
+#include <new>
+
+/**
+ * Graf cytowań z tym samym interfejsem co CitationGraph, dla wielu wątków naraz. Czytający (exists,
+ * get_children, get_parents, operator[], get_root_id) nie biorą żadnej blokady: czytają niezmienną wersję
+ * grafu (snapshot). Piszący są szeregowani muteksem i publikują nową wersję, która współdzieli z poprzednią
+ * wszystko poza ścieżkami do zmienionych elementów (drzewa trwałe, kopiowanie ścieżki).
+ * Zastąpione elementy są zwalniane paczkami, gdy żaden czytający nie może ich już widzieć (epoki).
+ *
+ * Referencja zwrócona przez operator[] jest ważna, dopóki publikacja nie zostanie usunięta
+ * (albo dopóki żyje Snapshot, z którego ją pobrano). Sama publikacja nie jest synchronizowana.
+ */
+template <class Publication> class ConcurrentCitationGraph {
+private:
+    using id_type = typename Publication::id_type;
+    using lookup_type = typename IdLookup<id_type>::type;
+    using node_index = uint32_t;
+    static constexpr node_index NO_NODE = UINT32_MAX;
+
+    static constexpr uint32_t BITS = 5;
+    static constexpr uint32_t WIDTH = 1u << BITS;
+    static constexpr uint32_t MASK = WIDTH - 1;
+
+    /// Nagłówek węzła drzewa trwałego, za nim leżą elementy (liść) albo wskaźniki na synów.
+    struct TrieNode {
+        uint64_t stamp;     // Transakcja, która utworzyła węzeł.
+        uint32_t count;
+        uint32_t capacity;
+    };
+
+    struct Garbage {
+        void *object;
+        void (*destroy)(void *) noexcept;
+    };
+
+    /// Miejsce na cnt_more elementów więcej; vector::reserve przydziela dokładnie tyle, ile prosimy.
+    template <class T> static void reserve_more(std::vector<T> &vector, size_t cnt_more) {
+        if (vector.capacity() - vector.size() < cnt_more)
+            vector.reserve(std::max(vector.size() + cnt_more, 2 * vector.capacity()));
+    }
+
+    template <class Object> static void destroy(void *object) noexcept {
+        delete static_cast<Object *>(object);
+    }
+
+    static void destroy_trie_node(void *node) noexcept {
+        ::operator delete(node);
+    }
+
+    /**
+     * Zmiany jednej operacji piszącego. Obiekty z jej znacznikiem nie są jeszcze opublikowane, więc można je
+     * zmieniać w miejscu; opublikowanych nie zmienia się nigdy, tylko zastępuje kopiami. Jeśli operacja się nie
+     * powiedzie, wszystko, co zaalokowała, jest zwalniane i opublikowana wersja zostaje nietknięta (silna
+     * gwarancja). Jeśli się uda, zastąpione obiekty czekają, aż żaden czytający ich nie zobaczy.
+     */
+    class Transaction {
+    public:
+        const uint64_t stamp;
+        std::vector<Garbage> allocated;
+        std::vector<Garbage> replaced;
+        bool committed = false;
+
+        explicit Transaction(uint64_t stamp) noexcept : stamp(stamp) {}
+
+        Transaction(const Transaction &) = delete;
+        Transaction& operator=(const Transaction &) = delete;
+
+        ~Transaction() {
+            if (!committed)
+                for (Garbage &garbage : allocated)
+                    garbage.destroy(garbage.object);
+        }
+
+        template <class Object, class... Args>
+        Object* make(Args &&... args) {
+            reserve_more(allocated, 1);
+            auto object = new Object(std::forward<Args>(args)...);
+            allocated.push_back({object, destroy<Object>});
+            return object;
+        }
+
+        TrieNode* allocate(size_t size) {
+            reserve_more(allocated, 1);
+            auto node = static_cast<TrieNode *>(::operator new(size));
+            allocated.push_back({node, destroy_trie_node});
+            return node;
+        }
+
+        template <class Object> void retire(Object *object) {
+            replaced.push_back({object, destroy<Object>});
+        }
+
+        void retire(TrieNode *node) {
+            replaced.push_back({node, destroy_trie_node});
+        }
+    };
+
+    /**
+     * Trwały wektor: drzewo o stopniu 32, liście trzymają elementy. Zmiany kopiują tylko ścieżkę od korzenia
+     * do zmienionego liścia (węzły bieżącej transakcji zmieniają w miejscu), reszta jest współdzielona
+     * z poprzednimi wersjami. Zastąpione węzły trafiają do śmieci transakcji. Sam wektor nie jest właścicielem
+     * węzłów - zwalnia je transakcja albo destruktor grafu.
+     */
+    template <class T> class PersistentVector {
+        static_assert(std::is_trivially_copyable_v<T>);
+
+    private:
+        TrieNode *root = nullptr;
+        uint32_t count = 0;
+        uint32_t shift = 0; // 0 - korzeń jest liściem.
+
+        static TrieNode** branch(TrieNode *node) noexcept {
+            return reinterpret_cast<TrieNode **>(node + 1);
+        }
+
+        static T* items(TrieNode *node) noexcept {
+            return reinterpret_cast<T *>(node + 1);
+        }
+
+        static size_t item_size(uint32_t shift) noexcept {
+            return shift == 0 ? sizeof(T) : sizeof(TrieNode *);
+        }
+
+        static TrieNode* allocate(Transaction &tx, uint32_t shift, uint32_t cnt_items, uint32_t capacity) {
+            TrieNode *node = tx.allocate(sizeof(TrieNode) + capacity * item_size(shift));
+            node->stamp = tx.stamp;
+            node->count = cnt_items;
+            node->capacity = capacity;
+            return node;
+        }
+
+        /// Węzeł, który wolno zmienić w tej transakcji, z miejscem na capacity elementów.
+        static TrieNode* writable(TrieNode *node, uint32_t shift, uint32_t capacity, Transaction &tx) {
+            bool own = node->stamp == tx.stamp;
+            if (own && node->capacity >= capacity)
+                return node;
+
+            if (own)
+                capacity = std::min(WIDTH, std::max(capacity, 2 * node->capacity));
+            TrieNode *result = allocate(tx, shift, node->count, capacity);
+            std::memcpy(result + 1, node + 1, node->count * item_size(shift));
+            tx.retire(node);
+            return result;
+        }
+
+        static TrieNode* new_path(uint32_t shift, const T &value, Transaction &tx) {
+            TrieNode *node = allocate(tx, shift, 1, 1);
+            if (shift == 0)
+                items(node)[0] = value;
+            else
+                branch(node)[0] = new_path(shift - BITS, value, tx);
+            return node;
+        }
+
+        static TrieNode* set_path(TrieNode *node, uint32_t shift, uint32_t i, const T &value, Transaction &tx) {
+            node = writable(node, shift, node->count, tx);
+            if (shift == 0) {
+                items(node)[i & MASK] = value;
+            } else {
+                uint32_t k = (i >> shift) & MASK;
+                branch(node)[k] = set_path(branch(node)[k], shift - BITS, i, value, tx);
+            }
+            return node;
+        }
+
+        static TrieNode* push_path(TrieNode *node, uint32_t shift, uint32_t i, const T &value, Transaction &tx) {
+            uint32_t k = (i >> shift) & MASK;
+            if (shift > 0 && k < node->count) {
+                node = writable(node, shift, node->count, tx);
+                branch(node)[k] = push_path(branch(node)[k], shift - BITS, i, value, tx);
+                return node;
+            }
+
+            node = writable(node, shift, node->count + 1, tx);
+            if (shift == 0)
+                items(node)[node->count] = value;
+            else
+                branch(node)[node->count] = new_path(shift - BITS, value, tx);
+            node->count++;
+            return node;
+        }
+
+        /// Usuwa element i (ostatni). Zwraca nullptr, jeśli węzeł został pusty.
+        static TrieNode* pop_path(TrieNode *node, uint32_t shift, uint32_t i, Transaction &tx) {
+            uint32_t k = (i >> shift) & MASK;
+            TrieNode *child = shift == 0 ? nullptr : pop_path(branch(node)[k], shift - BITS, i, tx);
+            if (child == nullptr && node->count == 1) {
+                tx.retire(node);
+                return nullptr;
+            }
+
+            node = writable(node, shift, node->count, tx);
+            if (child == nullptr)
+                node->count--;
+            else
+                branch(node)[k] = child;
+            return node;
+        }
+
+        static void retire_tree(TrieNode *node, uint32_t shift, Transaction &tx) {
+            if (shift > 0)
+                for (uint32_t i = 0; i < node->count; i++)
+                    retire_tree(branch(node)[i], shift - BITS, tx);
+            tx.retire(node);
+        }
+
+        static void free_tree(TrieNode *node, uint32_t shift) noexcept {
+            if (shift > 0)
+                for (uint32_t i = 0; i < node->count; i++)
+                    free_tree(branch(node)[i], shift - BITS);
+            ::operator delete(node);
+        }
+
+    public:
+        /// Buduje wektor z tablicy od liści w górę, w czasie liniowym.
+        static PersistentVector from_array(const std::vector<T> &array, Transaction &tx) {
+            PersistentVector result;
+            if (array.empty())
+                return result;
+
+            std::vector<TrieNode *> level;
+            for (size_t begin = 0; begin < array.size(); begin += WIDTH) {
+                uint32_t cnt_items = std::min<size_t>(WIDTH, array.size() - begin);
+                level.push_back(allocate(tx, 0, cnt_items, cnt_items));
+                std::copy_n(array.begin() + begin, cnt_items, items(level.back()));
+            }
+            for (; level.size() > 1; result.shift += BITS) {
+                std::vector<TrieNode *> upper;
+                for (size_t begin = 0; begin < level.size(); begin += WIDTH) {
+                    uint32_t cnt_children = std::min<size_t>(WIDTH, level.size() - begin);
+                    upper.push_back(allocate(tx, result.shift + BITS, cnt_children, cnt_children));
+                    std::copy_n(level.begin() + begin, cnt_children, branch(upper.back()));
+                }
+                level.swap(upper);
+            }
+            result.root = level[0];
+            result.count = array.size();
+            return result;
+        }
+
+        uint32_t size() const noexcept {
+            return count;
+        }
+
+        bool empty() const noexcept {
+            return count == 0;
+        }
+
+        /// Wskaźnik na element i; kolejne elementy aż do końca liścia leżą za nim.
+        const T* data_at(uint32_t i) const noexcept {
+            TrieNode *node = root;
+            for (uint32_t level = shift; level > 0; level -= BITS)
+                node = branch(node)[(i >> level) & MASK];
+            return items(node) + (i & MASK);
+        }
+
+        const T& operator[](uint32_t i) const noexcept {
+            return *data_at(i);
+        }
+
+        /// Woła visit(element) dla kolejnych elementów, liść po liściu.
+        template <class Visitor>
+        void for_each(Visitor &&visit) const {
+            for (uint32_t i = 0; i < count; i = (i | MASK) + 1) {
+                const T *leaf = data_at(i);
+                for (uint32_t j = 0, cnt = std::min(count - i, WIDTH - (i & MASK)); j < cnt; j++)
+                    visit(leaf[j]);
+            }
+        }
+
+        void assign(uint32_t i, const T &value, Transaction &tx) {
+            root = set_path(root, shift, i, value, tx);
+        }
+
+        void push_back(const T &value, Transaction &tx) {
+            if (root == nullptr) {
+                root = new_path(0, value, tx);
+            } else if (count < (WIDTH << shift)) {
+                root = push_path(root, shift, count, value, tx);
+            } else {
+                // Drzewo jest pełne - rośnie o poziom, stary korzeń zostaje pierwszym synem.
+                TrieNode *new_root = allocate(tx, shift + BITS, 2, 2);
+                branch(new_root)[0] = root;
+                branch(new_root)[1] = new_path(shift, value, tx);
+                root = new_root;
+                shift += BITS;
+            }
+            count++;
+        }
+
+        void pop_back(Transaction &tx) {
+            root = pop_path(root, shift, count - 1, tx);
+            count--;
+
+            // Korzeń z jednym synem zastępujemy tym synem.
+            while (shift > 0 && root->count == 1) {
+                tx.retire(root);
+                root = branch(root)[0];
+                shift -= BITS;
+            }
+            if (root == nullptr)
+                shift = 0;
+        }
+
+        /// Oddaje do śmieci wszystkie węzły - wektor zastępuje inny.
+        void retire(Transaction &tx) const {
+            if (root != nullptr)
+                retire_tree(root, shift, tx);
+        }
+
+        /// Zwalnia od razu wszystkie węzły; tylko dla destruktora grafu.
+        void free() const noexcept {
+            if (root != nullptr)
+                free_tree(root, shift);
+        }
+    };
+
+    struct Edge {
+        node_index node;
+        uint32_t back;
+    };
+
+    struct PublicationBox {
+        id_type id;
+        Publication publication;
+
+        explicit PublicationBox(id_type const &id) : id(id), publication(id) {}
+    };
+
+    /// Publikacja nie zmienia się między wersjami węzła, więc slot wskazuje ją wprost - exists porównuje id
+    /// bez schodzenia do tablicy węzłów.
+    struct Slot {
+        node_index node;
+        uint32_t hash_tag;
+        const PublicationBox *box;
+    };
+
+    using Adjacency = PersistentVector<Edge>;
+    using Slots = PersistentVector<Slot>;
+
+    /// Wersja węzła. Kolejne wersje tego samego węzła współdzielą publikację.
+    struct NodeVersion {
+        uint64_t stamp;
+        PublicationBox *box;
+        Adjacency children;
+        Adjacency parents;
+        uint64_t creation_order;
+    };
+
+    using Nodes = PersistentVector<NodeVersion *>;
+
+    /// Niezmienna wersja całego grafu.
+    struct Version {
+        Slots index;   // Tablica haszująca z adresowaniem liniowym, jak w CitationGraph.
+        Nodes nodes;   // nullptr dla wolnych numerów.
+        size_t cnt_publications = 0;
+        node_index root = NO_NODE;
+    };
+
+    /**
+     * Czytający zgłaszają się w liczniku odpowiadającym parzystości bieżącej epoki. Śmieci są zwalniane
+     * paczkami: piszący zmienia epokę, a gdy liczniki poprzedniej parzystości spadną do zera, zmienia ją drugi
+     * raz i znów czeka na zero - wtedy każdy czytający, który mógł widzieć coś z paczki, już skończył.
+     * Piszący nigdy nie czeka, tylko sprawdza postęp przy każdej publikacji. Liczniki są rozłożone na osobne
+     * linie pamięci podręcznej, żeby czytający z różnych wątków nie rywalizowali o jedną.
+     */
+    struct alignas(64) ReaderShard {
+        std::atomic<uint64_t> cnt_active[2] = {{0}, {0}};
+    };
+
+    static constexpr size_t CNT_SHARDS = 64;
+    static constexpr size_t RECLAIM_BATCH = 4096;
+
+    static size_t shard_of_this_thread() noexcept {
+        static thread_local size_t shard = std::hash<std::thread::id>{}(std::this_thread::get_id()) % CNT_SHARDS;
+        return shard;
+    }
+
+    mutable ReaderShard shards[CNT_SHARDS];
+    std::atomic<uint64_t> epoch{0};
+    std::atomic<Version *> current{nullptr};
+
+    // Stan piszących, chroniony przez writer_mutex.
+    std::mutex writer_mutex;
+    uint64_t cnt_transactions = 0;
+    std::vector<Garbage> retired;     // Czekają na następną paczkę.
+    std::vector<Garbage> draining;    // Bieżąca paczka.
+    unsigned cnt_epoch_changes = 0;   // Ile razy zmieniono epokę dla bieżącej paczki.
+    std::vector<node_index> free_nodes;
+    uint64_t cnt_created = 0;
+    bool may_have_cycles = false;
+
+    bool previous_epoch_left() const noexcept {
+        unsigned parity = (epoch.load(std::memory_order_seq_cst) - 1) & 1;
+        for (const ReaderShard &shard : shards)
+            if (shard.cnt_active[parity].load(std::memory_order_seq_cst) > 0)
+                return false;
+        return true;
+    }
+
+    /// Posuwa zwalnianie śmieci, nie czekając na czytających.
+    void reclaim() noexcept {
+        if (cnt_epoch_changes == 0) {
+            if (retired.size() < RECLAIM_BATCH)
+                return;
+            draining.swap(retired);
+        } else if (!previous_epoch_left()) {
+            return;
+        }
+
+        if (cnt_epoch_changes < 2) {
+            epoch.fetch_add(1, std::memory_order_seq_cst);
+            cnt_epoch_changes++;
+            return;
+        }
+        for (Garbage &garbage : draining)
+            garbage.destroy(garbage.object);
+        draining.clear();
+        cnt_epoch_changes = 0;
+    }
+
+    /// Publikuje wersję zbudowaną w transakcji, poprzednia trafia do śmieci.
+    /// Rzuca wyjątek tylko przed publikacją; stan piszących wolno zmieniać po niej tylko bez wyjątków.
+    void publish(Version *version, Transaction &tx) {
+        tx.retire(current.load(std::memory_order_relaxed));
+        reserve_more(retired, tx.replaced.size());
+
+        current.store(version, std::memory_order_seq_cst);
+        retired.insert(retired.end(), tx.replaced.begin(), tx.replaced.end());
+        tx.committed = true;
+        reclaim();
+    }
+
+    static uint32_t hash_tag(lookup_type id) {
+        using hashed_type = std::remove_cv_t<std::remove_reference_t<lookup_type>>;
+        return (std::hash<hashed_type>{}(id) * 0x9E3779B97F4A7C15ULL) >> 32;
+    }
+
+    static const NodeVersion& node(const Version &version, node_index i) noexcept {
+        return *version.nodes[i];
+    }
+
+    /// Pozycja slotu z publikacją o podanym id albo pustego slotu, w który należy ją wstawić.
+    static uint32_t probe(const Version &version, lookup_type id, uint32_t tag) {
+        // Tablica ma rozmiar będący potęgą dwójki, co najmniej WIDTH, więc liście są pełne - idziemy liść po liściu.
+        uint32_t mask = version.index.size() - 1;
+        for (uint32_t position = tag & mask;; position &= mask) {
+            const Slot *slot = version.index.data_at(position);
+            for (uint32_t leaf_end = (position | MASK) + 1; position < leaf_end; position++, slot++)
+                if (slot->node == NO_NODE || (slot->hash_tag == tag && slot->box->id == id))
+                    return position;
+        }
+    }
+
+    static node_index find(const Version &version, lookup_type id) {
+        return version.index[probe(version, id, hash_tag(id))].node;
+    }
+
+    static node_index checkExistence(const Version &version, lookup_type id) {
+        node_index i = find(version, id);
+        if (i == NO_NODE)
+            throw PublicationNotFound();
+        return i;
+    }
+
+    static std::vector<id_type> get_ids(const Version &version, const Adjacency &list) {
+        std::vector<id_type> ids;
+        ids.reserve(list.size());
+        list.for_each([&](const Edge &edge) { ids.push_back(node(version, edge.node).box->id); });
+        return ids;
+    }
+
+    // Operacje piszących - zmieniają roboczą wersję, która zostanie opublikowana na końcu transakcji.
+
+    /// Węzeł i, który wolno zmienić w tej transakcji; opublikowany zastępuje kopią.
+    static NodeVersion& writable_node(Version &version, node_index i, Transaction &tx) {
+        NodeVersion *current_node = version.nodes[i];
+        if (current_node->stamp == tx.stamp)
+            return *current_node;
+
+        auto copy = tx.template make<NodeVersion>(*current_node);
+        copy->stamp = tx.stamp;
+        version.nodes.assign(i, copy, tx);
+        tx.retire(current_node);
+        return *copy;
+    }
+
+    static void link(Version &version, node_index parent, node_index child, Transaction &tx) {
+        uint32_t child_position = node(version, parent).children.size();
+        uint32_t parent_position = node(version, child).parents.size();
+        writable_node(version, parent, tx).children.push_back({child, parent_position}, tx);
+        writable_node(version, child, tx).parents.push_back({parent, child_position}, tx);
+    }
+
+    static void erase_entry(Version &version, node_index owner, Adjacency NodeVersion::*list, uint32_t i,
+                            Adjacency NodeVersion::*opposite, Transaction &tx) {
+        Adjacency &entries = writable_node(version, owner, tx).*list;
+        Edge last = entries[entries.size() - 1];
+        entries.pop_back(tx);
+        if (i < entries.size()) {
+            entries.assign(i, last, tx);
+            (writable_node(version, last.node, tx).*opposite).assign(last.back, {owner, i}, tx);
+        }
+    }
+
+    static void unlink(Version &version, node_index parent, uint32_t i, Transaction &tx) {
+        Edge edge = node(version, parent).children[i];
+        erase_entry(version, edge.node, &NodeVersion::parents, edge.back, &NodeVersion::children, tx);
+        erase_entry(version, parent, &NodeVersion::children, i, &NodeVersion::parents, tx);
+    }
+
+    static void unlink_parents(Version &version, node_index i, Transaction &tx) {
+        while (!node(version, i).parents.empty()) {
+            const Adjacency &parents = node(version, i).parents;
+            Edge edge = parents[parents.size() - 1];
+            unlink(version, edge.node, edge.back, tx);
+        }
+    }
+
+    static void grow_index(Version &version, Transaction &tx) {
+        uint32_t capacity = version.index.size();
+        if (version.cnt_publications * 4 < capacity * 3)
+            return;
+
+        std::vector<Slot> slots(2 * capacity, Slot{NO_NODE, 0, nullptr});
+        version.index.for_each([&](const Slot &slot) {
+            if (slot.node == NO_NODE)
+                return;
+            uint32_t position = slot.hash_tag & (slots.size() - 1);
+            while (slots[position].node != NO_NODE)
+                position = (position + 1) & (slots.size() - 1);
+            slots[position] = slot;
+        });
+        Slots grown = Slots::from_array(slots, tx);
+        version.index.retire(tx);
+        version.index = grown;
+    }
+
+    static void erase_from_index(Version &version, node_index i, Transaction &tx) {
+        uint32_t mask = version.index.size() - 1;
+        uint32_t hole = hash_tag(node(version, i).box->id) & mask;
+        while (version.index[hole].node != i)
+            hole = (hole + 1) & mask;
+
+        for (uint32_t j = (hole + 1) & mask; version.index[j].node != NO_NODE; j = (j + 1) & mask) {
+            uint32_t home = version.index[j].hash_tag & mask;
+            if (((j - home) & mask) >= ((j - hole) & mask)) {
+                Slot moved = version.index[j];
+                version.index.assign(hole, moved, tx);
+                hole = j;
+            }
+        }
+        version.index.assign(hole, Slot{NO_NODE, 0, nullptr}, tx);
+        version.cnt_publications--;
+    }
+
+    /// Usuwa węzeł razem z jego krawędziami.
+    static void release_node(Version &version, node_index i, Transaction &tx) {
+        unlink_parents(version, i, tx);
+        while (!node(version, i).children.empty())
+            unlink(version, i, node(version, i).children.size() - 1, tx);
+        erase_from_index(version, i, tx);
+
+        NodeVersion *released = version.nodes[i];
+        version.nodes.assign(i, nullptr, tx);
+        tx.retire(released->box);
+        tx.retire(released);
+    }
+
+    /**
+     * Węzły, które trzeba zwolnić razem z to_remove w grafie, który może mieć cykle; wersja się przy tym
+     * nie zmienia. Próbne usuwanie jak w CitationGraph::remove_with_cycles: kaskada węzłów, którym nie
+     * został żaden rodzic, a potem w podgrafie osiągalnym z tych, które straciły tylko część rodziców, liczniki
+     * rodziców pomniejszone o krawędzie wewnętrzne. Węzeł z dodatnim licznikiem jest osiągalny spoza podgrafu,
+     * tak jak wszystko, co jest osiągalne z niego; reszta podgrafu ginie. Czas jest liniowy względem potomków
+     * usuwanego węzła, a nie całego grafu.
+     */
+    static std::vector<node_index> doomed_nodes(const Version &version, node_index to_remove) {
+        node_index root = version.root;
+
+        // Dla węzłów, które straciły rodzica - ilu rodziców im zostało; 0 oznacza węzeł do zwolnienia.
+        std::unordered_map<node_index, uint32_t> cnt_parents_left = {{to_remove, 0}};
+        std::vector<node_index> doomed = {to_remove};
+        for (size_t next = 0; next < doomed.size(); next++) {
+            node(version, doomed[next]).children.for_each([&](const Edge &edge) {
+                uint32_t &cnt_left = cnt_parents_left.try_emplace(edge.node, node(version, edge.node).parents.size())
+                        .first->second;
+                if (cnt_left > 0 && --cnt_left == 0 && edge.node != root)
+                    doomed.push_back(edge.node);
+            });
+        }
+        auto is_doomed = [&](node_index i) {
+            auto found = cnt_parents_left.find(i);
+            return found != cnt_parents_left.end() && found->second == 0 && i != root;
+        };
+
+        // Liczniki referencji w podgrafie kandydatów pomniejszone o krawędzie wewnętrzne. Źródło nigdy
+        // nie jest kandydatem - jego potomkowie na pewno przeżyją.
+        constexpr uint32_t REACHABLE = UINT32_MAX;
+        std::unordered_map<node_index, uint32_t> cnt_external;
+        std::vector<node_index> subgraph;
+        for (auto [i, cnt_left] : cnt_parents_left) {
+            if (cnt_left > 0 && i != root) {
+                cnt_external.emplace(i, cnt_left);
+                subgraph.push_back(i);
+            }
+        }
+        for (size_t next = 0; next < subgraph.size(); next++) {
+            node(version, subgraph[next]).children.for_each([&](const Edge &edge) {
+                if (is_doomed(edge.node))
+                    return;
+                auto [found, inserted] = cnt_external.try_emplace(edge.node, 0);
+                if (inserted) {
+                    // Poza kandydatami nikt nie stracił rodzica, a źródło ma referencję z zewnątrz.
+                    auto left = cnt_parents_left.find(edge.node);
+                    found->second = left != cnt_parents_left.end() ? left->second
+                                                                    : node(version, edge.node).parents.size();
+                    found->second += edge.node == root;
+                    subgraph.push_back(edge.node);
+                }
+                found->second--;
+            });
+        }
+
+        std::vector<node_index> stack;
+        for (node_index i : subgraph) {
+            uint32_t &cnt = cnt_external[i];
+            if (cnt == 0 || cnt == REACHABLE)
+                continue;
+            cnt = REACHABLE;
+            stack.push_back(i);
+            while (!stack.empty()) {
+                node_index reachable = stack.back();
+                stack.pop_back();
+                node(version, reachable).children.for_each([&](const Edge &edge) {
+                    auto found = cnt_external.find(edge.node);
+                    if (found != cnt_external.end() && found->second != REACHABLE) {
+                        found->second = REACHABLE;
+                        stack.push_back(edge.node);
+                    }
+                });
+            }
+        }
+        for (node_index i : subgraph)
+            if (cnt_external[i] != REACHABLE)
+                doomed.push_back(i);
+        return doomed;
+    }
+
+    /// Usuwa węzeł i to, co przestało być osiągalne ze źródła. Zwraca zwolnione numery węzłów.
+    std::vector<node_index> remove_node(Version &version, node_index to_remove, Transaction &tx) const {
+        std::vector<node_index> released;
+        if (!may_have_cycles) {
+            // Bez cykli węzeł jest osiągalny wtw, gdy ma rodzica - zwalniamy kolejno węzły bez rodziców.
+            unlink_parents(version, to_remove, tx);
+            std::vector<node_index> worklist = {to_remove};
+            while (!worklist.empty()) {
+                node_index i = worklist.back();
+                worklist.pop_back();
+                while (!node(version, i).children.empty()) {
+                    uint32_t last = node(version, i).children.size() - 1;
+                    node_index child = node(version, i).children[last].node;
+                    unlink(version, i, last, tx);
+                    if (node(version, child).parents.empty() && child != version.root)
+                        worklist.push_back(child);
+                }
+                release_node(version, i, tx);
+                released.push_back(i);
+            }
+            return released;
+        }
+
+        for (node_index i : doomed_nodes(version, to_remove)) {
+            release_node(version, i, tx);
+            released.push_back(i);
+        }
+        return released;
+    }
+
+public:
+    /**
+     * Spójny widok grafu: wszystkie odczyty przez ten sam Snapshot widzą tę samą wersję. Póki Snapshot żyje,
+     * nic z jego wersji nie zostanie zwolnione, więc nie należy go trzymać długo.
+     */
+    class Snapshot {
+    private:
+        friend class ConcurrentCitationGraph;
+
+        const Version *version;
+        std::atomic<uint64_t> *counter;
+
+        explicit Snapshot(const ConcurrentCitationGraph &graph) noexcept {
+            ReaderShard &shard = graph.shards[shard_of_this_thread()];
+            counter = &shard.cnt_active[graph.epoch.load(std::memory_order_seq_cst) & 1];
+            counter->fetch_add(1, std::memory_order_seq_cst);
+            version = graph.current.load(std::memory_order_seq_cst);
+        }
+
+    public:
+        Snapshot(const Snapshot &) = delete;
+        Snapshot& operator=(const Snapshot &) = delete;
+
+        ~Snapshot() {
+            counter->fetch_sub(1, std::memory_order_release);
+        }
+
+        bool exists(lookup_type id) const {
+            return find(*version, id) != NO_NODE;
+        }
+
+        id_type get_root_id() const noexcept(noexcept(std::declval<Publication>().get_id())) {
+            return node(*version, version->root).box->publication.get_id();
+        }
+
+        std::vector<id_type> get_children(lookup_type id) const {
+            return get_ids(*version, node(*version, checkExistence(*version, id)).children);
+        }
+
+        std::vector<id_type> get_parents(lookup_type id) const {
+            return get_ids(*version, node(*version, checkExistence(*version, id)).parents);
+        }
+
+        Publication& operator[](lookup_type id) const {
+            return node(*version, checkExistence(*version, id)).box->publication;
+        }
+    };
+
+    // Tworzy nowy graf. Tworzy także węzeł publikacji o identyfikatorze stem_id
+    explicit ConcurrentCitationGraph(id_type const &stem_id) {
+        Transaction tx(++cnt_transactions);
+        auto version = tx.template make<Version>();
+        auto box = tx.template make<PublicationBox>(stem_id);
+        version->nodes.push_back(tx.template make<NodeVersion>(NodeVersion{tx.stamp, box, {}, {}, 0}), tx);
+        version->index = Slots::from_array(std::vector<Slot>(WIDTH, Slot{NO_NODE, 0, nullptr}), tx);
+        version->index.assign(probe(*version, stem_id, hash_tag(stem_id)), Slot{0, hash_tag(stem_id), box}, tx);
+        version->cnt_publications = 1;
+        version->root = 0;
+        current.store(version);
+        tx.committed = true;
+    }
+
+    ConcurrentCitationGraph(const ConcurrentCitationGraph &) = delete;
+    ConcurrentCitationGraph& operator=(const ConcurrentCitationGraph &) = delete;
+
+    // Graf można niszczyć, gdy nikt już z niego nie czyta.
+    ~ConcurrentCitationGraph() {
+        for (Garbage &garbage : draining)
+            garbage.destroy(garbage.object);
+        for (Garbage &garbage : retired)
+            garbage.destroy(garbage.object);
+
+        Version *version = current.load();
+        version->nodes.for_each([](NodeVersion *node) {
+            if (node != nullptr) {
+                node->children.free();
+                node->parents.free();
+                delete node->box;
+                delete node;
+            }
+        });
+        version->nodes.free();
+        version->index.free();
+        delete version;
+    }
+
+    Snapshot snapshot() const noexcept {
+        return Snapshot(*this);
+    }
+
+    bool exists(lookup_type id) const {
+        return snapshot().exists(id);
+    }
+
+    id_type get_root_id() const noexcept(noexcept(std::declval<Publication>().get_id())) {
+        return snapshot().get_root_id();
+    }
+
+    std::vector<id_type> get_children(lookup_type id) const {
+        return snapshot().get_children(id);
+    }
+
+    std::vector<id_type> get_parents(lookup_type id) const {
+        return snapshot().get_parents(id);
+    }
+
+    Publication& operator[](lookup_type id) const {
+        return snapshot()[id];
+    }
+
+    void create(id_type const &id, id_type const &parent_id) {
+        create(id, std::vector<id_type> {parent_id});
+    }
+
+    void create(id_type const &id, std::vector<id_type> const &parent_ids) {
+        std::lock_guard<std::mutex> lock(writer_mutex);
+        Transaction tx(++cnt_transactions);
+        auto version = tx.template make<Version>(*current.load(std::memory_order_relaxed));
+
+        uint32_t tag = hash_tag(id);
+        if (version->index[probe(*version, id, tag)].node != NO_NODE)
+            throw PublicationAlreadyCreated();
+        if (parent_ids.empty())
+            throw PublicationNotFound();
+        std::vector<node_index> parents;
+        for (auto &parent_id : parent_ids)
+            parents.push_back(checkExistence(*version, parent_id));
+        std::sort(parents.begin(), parents.end());
+        parents.erase(std::unique(parents.begin(), parents.end()), parents.end());
+
+        auto box = tx.template make<PublicationBox>(id);
+        auto new_node = tx.template make<NodeVersion>(NodeVersion{tx.stamp, box, {}, {}, cnt_created + 1});
+        node_index i = free_nodes.empty() ? version->nodes.size() : free_nodes.back();
+        if (i == version->nodes.size())
+            version->nodes.push_back(new_node, tx);
+        else
+            version->nodes.assign(i, new_node, tx);
+
+        version->cnt_publications++;
+        grow_index(*version, tx);
+        version->index.assign(probe(*version, id, tag), Slot{i, tag, box}, tx);
+        for (node_index parent : parents)
+            link(*version, parent, i, tx);
+
+        publish(version, tx);
+        if (!free_nodes.empty())
+            free_nodes.pop_back();
+        cnt_created++;
+    }
+
+    void add_citation(lookup_type child_id, lookup_type parent_id) {
+        std::lock_guard<std::mutex> lock(writer_mutex);
+        Transaction tx(++cnt_transactions);
+        auto version = tx.template make<Version>(*current.load(std::memory_order_relaxed));
+        node_index child = checkExistence(*version, child_id);
+        node_index parent = checkExistence(*version, parent_id);
+
+        bool linked = false;
+        node(*version, child).parents.for_each([&](const Edge &edge) { linked |= edge.node == parent; });
+        if (linked)
+            return;
+
+        link(*version, parent, child, tx);
+        publish(version, tx);
+        if (node(*version, parent).creation_order >= node(*version, child).creation_order)
+            may_have_cycles = true;
+    }
+
+    void remove(lookup_type id) {
+        std::lock_guard<std::mutex> lock(writer_mutex);
+        Transaction tx(++cnt_transactions);
+        auto version = tx.template make<Version>(*current.load(std::memory_order_relaxed));
+        node_index to_remove = checkExistence(*version, id);
+        if (to_remove == version->root)
+            throw TriedToRemoveRoot();
+
+        std::vector<node_index> released = remove_node(*version, to_remove, tx);
+        reserve_more(free_nodes, released.size());
+        publish(version, tx);
+        free_nodes.insert(free_nodes.end(), released.begin(), released.end());
+    }
+};
+
+
+#endif //CONCURRENT_CITATION_GRAPH_H
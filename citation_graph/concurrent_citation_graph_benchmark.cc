@@ -0,0 +1,131 @@
+#include "citation_graph.h"
+#include "concurrent_citation_graph.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+
+// Skalowanie czytających przy jednym piszącym:
+// ./concurrent_citation_graph_benchmark [liczba_publikacji] [czas_pomiaru_ms], domyślnie 1M i 500 ms.
+// Porównuje ConcurrentCitationGraph z CitationGraph chronionym przez std::shared_mutex.
+
+class Publication {
+public:
+  typedef uint64_t id_type;
+  Publication(id_type const &_id) : id(_id) {
+  }
+  id_type get_id() const noexcept {
+    return id;
+  }
+private:
+  id_type id;
+};
+
+// CitationGraph z blokadą czytelników i pisarzy - punkt odniesienia.
+class LockedGraph {
+public:
+  explicit LockedGraph(Publication::id_type stem_id) : graph(stem_id) {
+  }
+  bool exists(Publication::id_type id) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return graph.exists(id);
+  }
+  std::vector<Publication::id_type> get_children(Publication::id_type id) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return graph.get_children(id);
+  }
+  void create(Publication::id_type id, std::vector<Publication::id_type> const &parent_ids) {
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    graph.create(id, parent_ids);
+  }
+  void remove(Publication::id_type id) {
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    graph.remove(id);
+  }
+private:
+  mutable std::shared_mutex mutex;
+  CitationGraph<Publication> graph;
+};
+
+struct Result {
+  double reads_per_second;
+  double writes_per_second;
+};
+
+// Czytający losują publikacje spośród początkowych (nikt ich nie usuwa), piszący dokłada i usuwa nowe,
+// o identyfikatorach od next_id w górę.
+template <class Graph>
+Result measure(Graph &graph, uint64_t cnt_publications, uint64_t &next_id, unsigned cnt_readers,
+               std::chrono::milliseconds duration) {
+  std::atomic<bool> stop{false};
+  std::atomic<uint64_t> cnt_reads{0};
+  uint64_t cnt_writes = 0;
+
+  std::vector<std::thread> readers;
+  for (unsigned r = 0; r < cnt_readers; r++) {
+    readers.emplace_back([&, r] {
+      std::mt19937_64 rng(r);
+      uint64_t local_reads = 0, checksum = 0;
+      while (!stop.load(std::memory_order_relaxed)) {
+        uint64_t id = rng() % cnt_publications;
+        checksum += graph.exists(id) + graph.get_children(id).size();
+        local_reads += 2;
+      }
+      cnt_reads += local_reads + (checksum == 0);
+    });
+  }
+
+  std::thread writer([&] {
+    std::mt19937_64 rng(next_id);
+    while (!stop.load(std::memory_order_relaxed)) {
+      graph.create(next_id, {rng() % cnt_publications});
+      if (next_id % 2 == 1)
+        graph.remove(next_id - 1);
+      next_id++;
+      cnt_writes++;
+    }
+    if (next_id % 2 == 1)
+      graph.remove(next_id++ - 1);
+  });
+
+  std::this_thread::sleep_for(duration);
+  stop = true;
+  for (auto &reader : readers)
+    reader.join();
+  writer.join();
+
+  std::chrono::duration<double> seconds = duration;
+  return {cnt_reads / seconds.count(), cnt_writes / seconds.count()};
+}
+
+template <class Graph>
+void fill(Graph &graph, uint64_t cnt_publications) {
+  std::mt19937_64 rng(2020);
+  for (uint64_t id = 1; id < cnt_publications; id++)
+    graph.create(id, {rng() % id});
+}
+
+int main(int argc, char *argv[]) {
+  uint64_t const cnt_publications = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1'000'000;
+  std::chrono::milliseconds const duration(argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 500);
+
+  ConcurrentCitationGraph<Publication> concurrent(0);
+  LockedGraph locked(0);
+  uint64_t concurrent_next_id = cnt_publications, locked_next_id = cnt_publications;
+  fill(concurrent, cnt_publications);
+  fill(locked, cnt_publications);
+
+  std::cout << "readers\tconcurrent reads/s\twrites/s\tshared_mutex reads/s\twrites/s" << std::endl;
+  for (unsigned cnt_readers = 1; cnt_readers <= 64; cnt_readers *= 2) {
+    Result a = measure(concurrent, cnt_publications, concurrent_next_id, cnt_readers, duration);
+    Result b = measure(locked, cnt_publications, locked_next_id, cnt_readers, duration);
+    std::cout << cnt_readers << '\t' << a.reads_per_second << '\t' << a.writes_per_second << '\t'
+              << b.reads_per_second << '\t' << b.writes_per_second << std::endl;
+  }
+}
@@ -4,45 +4,511 @@
   element_tag = e.g. E5, R1 etc.
   element_type: e.g. 1uF/6,3V etc.
 
-  unordered_map<char, string_map> elements_labels; Maps: {elements_labels} -> {{elements_tags} -> {elements_types}}
-  unordered_map<string, unordered_map<char, set<string>>> elements_types; Maps: {elements_types} ->
-  {{element_label} -> {elements_tags_of_given_type_and_label}}
-  map<int, int> cnt_nodes_plugs; {nodes_id} -> {#terminals_plugged_in}
+  Circuit is stored column-wise (see circuit_structures::circuit_data), i-th element is described by:
+  keys[i] - element_key: index of the label and number of the tag packed in one integer,
+  types[i] - id of element type interned in type_table,
+  pins[pins_begin[i]..pins_begin[i + 1]) - different nodes to which element's terminals are plugged.
+  Numbers in tags have no leading zeros, therefore order of tags is the order of keys.
 */
 
 #include <iostream>
+#include <unordered_map>
 #include <map>
 #include <set>
-#include <unordered_map>
-#include <sstream>
-#include <regex>
-#include <list>
+#include <string_view>
+#include <vector>
+#include <deque>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <utility>
+#include <charconv>
+#include <type_traits>
+#include <iterator>
+#include <initializer_list>
+#include <functional>
+#include <cerrno>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 using namespace std;
 
 namespace circuit_structures {
+    /**
+    * @brief Labels of elements in the order of listing.
+    */
+    constexpr char ELEMENT_LABELS[] = {'T', 'D', 'R', 'C', 'E'};
+    constexpr int CNT_ELEMENT_LABELS = sizeof(ELEMENT_LABELS);
+
+    /**
+    * @brief Element's tag packed in one integer: index of the label in ELEMENT_LABELS and number of the element.
+    */
+    using element_key = uint64_t;
+    constexpr int LABEL_SHIFT = 30; /**< Numbers have at most 9 digits, so they fit in 30 bits. */
+    constexpr uint32_t NO_ID = UINT32_MAX;
+    constexpr int TRANSISTOR_NODES = 3;
+    constexpr int OTHER_ELEMENT_NODES = 2;
+
+    inline int label_index(char element_label) {
+        return find(ELEMENT_LABELS, ELEMENT_LABELS + CNT_ELEMENT_LABELS, element_label) - ELEMENT_LABELS;
+    }
+
+    inline element_key make_key(char element_label, int number) {
+        return (element_key) label_index(element_label) << LABEL_SHIFT | (element_key) number;
+    }
+
+    inline char key_label(element_key key) {
+        return ELEMENT_LABELS[key >> LABEL_SHIFT];
+    }
+
+    inline int key_number(element_key key) {
+        return (int) (key & ((element_key(1) << LABEL_SHIFT) - 1));
+    }
+
+    /**
+    * @brief Key of (label, type) group: index of the label and id of the type packed in one integer.
+    */
+    inline uint64_t group_key(element_key key, uint32_t type) {
+        return (uint64_t) (key >> LABEL_SHIFT) << 32 | type;
+    }
+
+    inline int group_label_index(uint64_t key) {
+        return key >> 32;
+    }
+
+    /**
+    * @return Number of terminals of the element.
+    */
+    inline int cnt_terminals(element_key key) {
+        return key_label(key) == 'T' ? TRANSISTOR_NODES : OTHER_ELEMENT_NODES;
+    }
+
+    /**
+    * @brief Sorts keys with LSD radix sort, one byte per pass. Passes in which all keys share the byte are skipped.
+    */
+    void radix_sort(vector<uint64_t> &keys) {
+        vector<uint64_t> buffer(keys.size());
+
+        for (int shift = 0; shift < 64 && !keys.empty(); shift += 8) {
+            size_t cnt[256] = {};
+            for (uint64_t key : keys)
+                cnt[(key >> shift) & 0xFF]++;
+            if (cnt[(keys[0] >> shift) & 0xFF] == keys.size())
+                continue;
+
+            size_t offset = 0;
+            for (size_t &c : cnt)
+                offset += exchange(c, offset);
+            for (uint64_t key : keys)
+                buffer[cnt[(key >> shift) & 0xFF]++] = key;
+            keys.swap(buffer);
+        }
+    }
+
+    /**
+    * @brief Hash of the data, processed in 8-byte words. It detects changes, it is not meant to resist attacks.
+    */
+    uint64_t hash_bytes(const char *data, size_t size) {
+        constexpr uint64_t PRIME = 0x100000001B3ULL;
+        uint64_t hash = 0xCBF29CE484222325ULL ^ size;
+        uint64_t word;
+        size_t i = 0;
+
+        for (; i + sizeof(word) <= size; i += sizeof(word)) {
+            memcpy(&word, data + i, sizeof(word));
+            hash = (hash ^ word) * PRIME;
+            hash ^= hash >> 29;
+        }
+        for (; i < size; i++)
+            hash = (hash ^ (unsigned char) data[i]) * PRIME;
+
+        return hash;
+    }
+
+    /**
+    * @brief Set of element keys - open addressing with linear probing, kept at most half full.
+    */
+    class key_set {
+    private:
+        static constexpr uint64_t EMPTY_SLOT = UINT64_MAX;
+        static constexpr size_t INITIAL_CAPACITY = 1 << 10;
+
+        vector<uint64_t> slots = vector<uint64_t>(INITIAL_CAPACITY, EMPTY_SLOT);
+        size_t cnt_keys = 0;
+
+        size_t slot_of(uint64_t key) const {
+            return (key * 0x9E3779B97F4A7C15ULL >> 20) & (slots.size() - 1);
+        }
+
+        void grow() {
+            vector<uint64_t> old_slots(2 * slots.size(), EMPTY_SLOT);
+            old_slots.swap(slots);
+            for (uint64_t key : old_slots) {
+                if (key != EMPTY_SLOT) {
+                    size_t i = slot_of(key);
+                    while (slots[i] != EMPTY_SLOT)
+                        i = (i + 1) & (slots.size() - 1);
+                    slots[i] = key;
+                }
+            }
+        }
 
-    class cmp_by_string_length {
     public:
-        bool operator()(const string &a, const string &b) const {
-            if (a.length() < b.length())
-                return true;
-            else if (a.length() > b.length())
-                return false;
-            return a.compare(b) < 0;
+        /**
+        * @return True if key was inserted, false if it was already in the set.
+        */
+        bool insert(uint64_t key) {
+            if (2 * (cnt_keys + 1) > slots.size())
+                grow();
+
+            size_t i = slot_of(key);
+            while (slots[i] != EMPTY_SLOT) {
+                if (slots[i] == key)
+                    return false;
+                i = (i + 1) & (slots.size() - 1);
+            }
+            slots[i] = key;
+            cnt_keys++;
+            return true;
+        }
+
+        bool contains(uint64_t key) const {
+            size_t i = slot_of(key);
+            while (slots[i] != EMPTY_SLOT) {
+                if (slots[i] == key)
+                    return true;
+                i = (i + 1) & (slots.size() - 1);
+            }
+            return false;
+        }
+    };
+
+    /**
+    * @brief Assigns consecutive ids to different element types.
+    * Views in the index point into strings kept in deque, which never moves its elements.
+    */
+    class type_table {
+    private:
+        deque<string> names;
+        unordered_map<string_view, uint32_t> ids;
+
+    public:
+        type_table() = default;
+        type_table(type_table &&) = default;
+        type_table &operator=(type_table &&) = default;
+        type_table(const type_table &) = delete;
+        type_table &operator=(const type_table &) = delete;
+
+        uint32_t intern(string_view type) {
+            auto it = ids.find(type);
+            if (it != ids.end())
+                return it->second;
+
+            names.emplace_back(type);
+            ids.emplace(names.back(), names.size() - 1);
+            return names.size() - 1;
+        }
+
+        const string &name(uint32_t id) const {
+            return names[id];
+        }
+
+        size_t size() const {
+            return names.size();
+        }
+    };
+
+    /**
+    * @brief Read-only memory mapping of a file, unmapped when destroyed.
+    */
+    class file_mapping {
+    private:
+        void *data = nullptr;
+        size_t size = 0;
+
+    public:
+        file_mapping() = default;
+        file_mapping(void *data, size_t size) : data(data), size(size) {}
+        file_mapping(file_mapping &&other) noexcept
+            : data(exchange(other.data, nullptr)), size(exchange(other.size, 0)) {}
+
+        file_mapping &operator=(file_mapping &&other) noexcept {
+            swap(data, other.data);
+            swap(size, other.size);
+            return *this;
+        }
+
+        ~file_mapping() {
+            if (data != nullptr)
+                munmap(data, size);
+        }
+
+        const char *bytes() const {
+            return static_cast<const char *>(data);
+        }
+    };
+
+    /**
+    * @brief Column of the circuit: either its own growing array or a view of an array in a mapped file,
+    * which can only be read.
+    */
+    template<typename T>
+    class column {
+    private:
+        vector<T> items;
+        const T *mapped = nullptr; /**< Used instead of items if not null. */
+        size_t cnt_mapped = 0;
+
+    public:
+        column() = default;
+        column(initializer_list<T> items) : items(items) {}
+
+        /**
+        * @brief Makes the column a view of size items at data, which have to outlive the column.
+        */
+        void view(const T *data, size_t size) {
+            items.clear();
+            mapped = data;
+            cnt_mapped = size;
+        }
+
+        void push_back(T item) {
+            items.push_back(item);
+        }
+
+        void append(const T *first, const T *last) {
+            items.insert(items.end(), first, last);
+        }
+
+        const T *data() const {
+            return mapped != nullptr ? mapped : items.data();
+        }
+
+        size_t size() const {
+            return mapped != nullptr ? cnt_mapped : items.size();
+        }
+
+        const T *begin() const {
+            return data();
+        }
+
+        const T *end() const {
+            return data() + size();
+        }
+
+        const T &operator[](size_t i) const {
+            return data()[i];
+        }
+    };
+
+    /**
+    * @brief Elements of the circuit stored column-wise. Circuit loaded from the cache reads the columns straight
+    * from the mapped file and is never extended, so its tags are left empty.
+    */
+    struct circuit_data {
+        column<element_key> keys;
+        column<uint32_t> types;
+        column<uint32_t> pins_begin = {0};
+        column<int> pins;
+        type_table type_names;
+        key_set tags; /**< Keys of all elements, used to detect repetitions. */
+        file_mapping mapping; /**< File the columns are views of, if any. */
+
+        size_t size() const {
+            return keys.size();
+        }
+
+        uint32_t cnt_pins(size_t element) const {
+            return pins_begin[element + 1] - pins_begin[element];
+        }
+
+        /**
+        * @brief Appends element, it's tag must not be present yet.
+        */
+        void add(element_key key, uint32_t type, const int *nodes, int cnt_nodes) {
+            keys.push_back(key);
+            types.push_back(type);
+            pins.append(nodes, nodes + cnt_nodes);
+            pins_begin.push_back(pins.size());
+        }
+    };
+
+    /**
+    * @brief Elements grouped by (label, type) in the order of listing: groups follow the order of labels and,
+    * within a label, the order of their first tags. Elements of a group are in the order of tags.
+    * Elements of i-th group are elements[group_begin[i]..group_begin[i + 1]).
+    */
+    struct element_groups {
+        vector<uint32_t> elements;
+        vector<uint32_t> group_begin = {0};
+
+        size_t cnt_groups() const {
+            return group_begin.size() - 1;
+        }
+
+        const uint32_t *begin(size_t group) const {
+            return elements.data() + group_begin[group];
+        }
+
+        const uint32_t *end(size_t group) const {
+            return elements.data() + group_begin[group + 1];
         }
     };
 
-    using string_map = map<string, string, cmp_by_string_length>;
-    using mapping_structures = tuple<unordered_map<char, string_map>,
-            unordered_map<string, unordered_map<char, set<string, cmp_by_string_length>>>,
-            map<int, int>>;
+    /**
+    * @brief Returns indices of elements sorted by tags: (label, number).
+    * Key and index are packed in one integer and sorted with radix sort.
+    */
+    vector<uint32_t> sorted_elements(const circuit_data &circuit) {
+        constexpr int INDEX_BITS = 64 - LABEL_SHIFT - 3;
+        vector<uint64_t> packed(circuit.size());
+
+        for (size_t i = 0; i < circuit.size(); i++)
+            packed[i] = circuit.keys[i] << INDEX_BITS | i;
+        radix_sort(packed);
+
+        vector<uint32_t> order(packed.size());
+        for (size_t i = 0; i < packed.size(); i++)
+            order[i] = packed[i] & ((uint64_t(1) << INDEX_BITS) - 1);
+
+        return order;
+    }
+
+    /**
+    * @brief Groups elements in a single counting sort pass over elements sorted by tags. Groups are numbered
+    * when their first element is met, so they are numbered in order of listing. Circuit is not modified.
+    */
+    element_groups group_elements(const circuit_data &circuit) {
+        vector<uint32_t> order = sorted_elements(circuit);
+        size_t cnt_types = circuit.type_names.size();
+        vector<uint32_t> group_of(CNT_ELEMENT_LABELS * cnt_types, NO_ID);
+        vector<uint32_t> element_group(order.size());
+        element_groups groups;
+        vector<uint32_t> &group_begin = groups.group_begin;
+        group_begin.clear();
+
+        for (size_t i = 0; i < order.size(); i++) {
+            uint32_t element = order[i];
+            uint32_t &group = group_of[(circuit.keys[element] >> LABEL_SHIFT) * cnt_types + circuit.types[element]];
+            if (group == NO_ID) {
+                group = group_begin.size();
+                group_begin.push_back(0);
+            }
+            group_begin[group]++;
+            element_group[i] = group;
+        }
+
+        uint32_t offset = 0;
+        for (uint32_t &begin : group_begin)
+            offset += exchange(begin, offset);
+        group_begin.push_back(offset);
+
+        vector<uint32_t> group_end(group_begin.begin(), group_begin.end() - 1);
+        groups.elements.resize(order.size());
+        for (size_t i = 0; i < order.size(); i++)
+            groups.elements[group_end[element_group[i]]++] = order[i];
+
+        return groups;
+    }
+
+    /**
+    * @brief Element/node incidence graph in compressed sparse row form. Nodes are numbered 0.. in increasing
+    * order of their ids. Element -> nodes direction is given by circuit_data::pins, here it is translated
+    * to node indices (pin_nodes); node -> elements direction is stored in elements_begin / elements.
+    * Node 0 is always part of the graph.
+    */
+    struct node_graph {
+        vector<int> node_ids;            /**< Id of i-th node. */
+        vector<uint32_t> pin_nodes;      /**< Index of node of every pin, parallel to circuit_data::pins. */
+        vector<uint32_t> elements_begin; /**< Elements of i-th node are elements[elements_begin[i]..elements_begin[i + 1]). */
+        vector<uint32_t> elements;
+
+        size_t cnt_nodes() const {
+            return node_ids.size();
+        }
+    };
 }
 
 
+namespace output {
+    /**
+    * @brief Growable buffer into which output is rendered. Content is written to the file descriptor
+    * with a single write call on flush (or destruction); only output larger than FLUSH_THRESHOLD is split.
+    * Default constructed buffer is not bound to any file descriptor and only collects the output.
+    */
+    class output_buffer {
+    private:
+        static constexpr size_t FLUSH_THRESHOLD = 64 << 20;
+        static constexpr size_t MAX_NUMBER_LENGTH = 24;
+
+        int fd = -1;
+        string content;
+
+    public:
+        output_buffer() = default;
+        explicit output_buffer(int fd) : fd(fd) {}
+
+        output_buffer(const output_buffer &) = delete;
+        output_buffer &operator=(const output_buffer &) = delete;
+
+        ~output_buffer() {
+            flush();
+        }
+
+        output_buffer &operator<<(string_view text) {
+            content.append(text);
+            if (content.size() > FLUSH_THRESHOLD && fd >= 0)
+                flush();
+            return *this;
+        }
+
+        output_buffer &operator<<(char c) {
+            content.push_back(c);
+            return *this;
+        }
+
+        /**
+        * @brief Formats integer with to_chars directly into the buffer.
+        */
+        template<typename Integer, typename = enable_if_t<is_integral_v<Integer>>>
+        output_buffer &operator<<(Integer number) {
+            size_t old_size = content.size();
+            content.resize(old_size + MAX_NUMBER_LENGTH);
+            char *end = to_chars(&content[old_size], &content[old_size] + MAX_NUMBER_LENGTH, number).ptr;
+            content.resize(end - content.data());
+            return *this;
+        }
+
+        string_view view() const {
+            return content;
+        }
+
+        void flush() {
+            if (fd < 0)
+                return;
+
+            size_t written = 0;
+            while (written < content.size()) {
+                ssize_t result = write(fd, content.data() + written, content.size() - written);
+                if (result < 0 && errno != EINTR)
+                    break;
+                written += max(result, ssize_t(0));
+            }
+            content.clear();
+        }
+    };
+} // End of the namespace output.
+
 namespace reader {
     using namespace circuit_structures;
-    const string EMPTY_STRING = "";
+    using output::output_buffer;
 
     class wrong_input_exception : public exception {
     private:
@@ -66,274 +532,594 @@ namespace reader {
     };
 
     /**
-    * @brief Determines whether given string matches given regular expression.
-    *
-    * @param[in] s - sequence to check for match.
-    * @param[in] regex_temple - regular expression which is to be matched.
-    * @return True if s matches @p regex_temple, false otherwise.
+    * @brief Reads standard input in large blocks and splits it into lines.
+    * Lines are handed out as views into the internal buffer, so no per-line allocation takes place.
+    * Semantics follow getline: the trailing '\n' is dropped and the last line does not need to end with it.
     */
-    bool matches_template(const string &s, const regex &regex_temple) {
-        return regex_match(s, regex_temple);
-    }
+    class line_reader {
+    private:
+        static constexpr size_t BLOCK_SIZE = 1 << 20;
+
+        FILE *input;
+        vector<char> buffer;
+        size_t begin = 0; /**< Beginning of not yet consumed data. */
+        size_t end = 0;   /**< End of valid data in buffer. */
+        bool eof = false;
+
+        /**
+        * @brief Moves unconsumed data to the front of the buffer and appends next block of input.
+        * Buffer is doubled when a single line does not fit in it.
+        */
+        void refill() {
+            if (begin > 0) {
+                memmove(buffer.data(), buffer.data() + begin, end - begin);
+                end -= begin;
+                begin = 0;
+            }
+            if (end == buffer.size())
+                buffer.resize(2 * buffer.size());
+
+            size_t cnt_read = fread(buffer.data() + end, 1, buffer.size() - end, input);
+            end += cnt_read;
+            if (cnt_read == 0)
+                eof = true;
+        }
+
+    public:
+        explicit line_reader(FILE *input) : input(input), buffer(BLOCK_SIZE) {}
+
+        /**
+        * @param[out] line - next line of input, valid until the following call.
+        * @return False if there are no more lines, true otherwise.
+        */
+        bool next_line(string_view &line) {
+            while (true) {
+                auto newline = static_cast<const char *>(memchr(buffer.data() + begin, '\n', end - begin));
+                if (newline != nullptr) {
+                    size_t pos = newline - buffer.data();
+                    line = string_view(buffer.data() + begin, pos - begin);
+                    begin = pos + 1;
+                    return true;
+                }
+                if (eof) {
+                    if (begin == end)
+                        return false;
+                    line = string_view(buffer.data() + begin, end - begin);
+                    begin = end;
+                    return true;
+                }
+                refill();
+            }
+        }
+    };
+
+    constexpr int MAX_NUMBER_DIGITS = 9;
 
     /**
-    * @brief Determines whether given string matches any of regular expressions in the given list.
-    *
-    * @param[in] s - sequence to check for match.
-    * @param[in] regex_list - list of regular expressions which are to be matched.
-    * @return True if @par s matches any regular expression in the given list.
+    * @brief Tokenized element line. Views point into the scanned line.
     */
-    bool matches_any_template(const string &s, list<regex> &regex_list) {
-        for (const auto &reg : regex_list)
-            if (matches_template(s, reg))
-                return true;
-        return false;
-    }
+    struct element_description {
+        char label;
+        int number;
+        string_view type;
+        int nodes[TRANSISTOR_NODES];
+        int cnt_nodes;
+    };
 
     /**
-    * @brief Creates list of regular expressions that matches correct input.
-    *
-    * @return List of created regular expressions.
+    * @brief Same set of characters as \\s in regular expressions.
     */
-    list<regex> create_regex_for_elements_data() {
-        list <regex> l;
-        const regex transistor_regex(
-                R"(\s*[T](0|[1-9]{1}\d{0,8})\s+([A-Z]|\d)([A-Za-z0-9]|[,\-\/])*(\s+(0|[1-9]{1}\d{0,8})){3}\s*)");
-        const regex other_elements_regex(
-                R"(\s*[DRCE](0|[1-9]{1}\d{0,8})\s+([A-Z]|\d)([A-Za-z0-9]|[,\-\/])*(\s+(0|[1-9]{1}\d{0,8})){2}\s*)");
+    inline bool is_white(char c) {
+        return c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' || c == '\r';
+    }
 
-        l.push_back(transistor_regex);
-        l.push_back(other_elements_regex);
+    inline bool is_digit(char c) {
+        return '0' <= c && c <= '9';
+    }
 
-        return l;
+    inline bool is_type_first_char(char c) {
+        return ('A' <= c && c <= 'Z') || is_digit(c);
     }
 
-    /**
-    * @brief Increases (+1) counter of terminals plugged in the given node.
-    *
-    * @param[in, out] cnt_nodes_plugs - structure containing counters for every node in the circuit.
-    * @param[in] node_id - id of node whose counter is to be increased.
-    */
-    void update_nodes_plugs(map<int, int> &cnt_nodes_plugs, int node_id) {
-        cnt_nodes_plugs[node_id]++;
+    inline bool is_type_char(char c) {
+        return is_type_first_char(c) || ('a' <= c && c <= 'z') || c == ',' || c == '-' || c == '/';
     }
 
     /**
-    * @brief Determines whether element with given tag has been already added to dataset.
+    * @brief Scans number matching (0|[1-9]\d{0,8}) which has to be followed by white character or end of line.
     *
-    * @param[in, out] elements_labels - Structure containing mapping:
-    * {elements_labels} -> {{elements_tags} -> {elements_types}}
-    * @param[in] element_tag - tag of element to be checked.
-    * @return True if similar element has been already added to data, false otherwise.
+    * @param[in] line - scanned line.
+    * @param[in, out] pos - position of the first digit, after return: position just after the number.
+    * @param[out] number - scanned value.
+    * @return True if number is correct, false otherwise.
     */
-    bool is_repetition(unordered_map<char, string_map> &elements_labels, const string &element_tag) {
-        char element_label = element_tag[0];
-        return elements_labels[element_label].count(element_tag) > 0;
+    bool scan_number(string_view line, size_t &pos, int &number) {
+        size_t first = pos;
+        number = 0;
+        while (pos < line.size() && is_digit(line[pos]) && pos - first < MAX_NUMBER_DIGITS)
+            number = 10 * number + (line[pos++] - '0');
+
+        if (pos == first || (line[first] == '0' && pos - first > 1))
+            return false;
+        return pos == line.size() || is_white(line[pos]);
     }
 
     /**
-    * @brief Determines whether read data meets given requirements:
-    * Element's tag is not repetition = elements in circuit must be unique.
-    * Element's terminals have to be plugged into at least two different nodes == nodes_connected must
-    * contain at least two elements.
-    *
-    * @param elements_labels - Structure containing mapping:
-    * {elements_labels} -> {{elements_tags} -> {elements_types}}
-    * @param element_tag - tag of element to be checked.
-    * @param nodes_connected - set of nodes to which are connected element's terminals.
+    * @brief Skips white characters.
     *
-    * @return True if data meet requirements, false otherwise.
+    * @return Number of skipped characters.
     */
-    bool is_correct_data(unordered_map<char, string_map> &elements_labels, const string &element_tag,
-                         set<int> &nodes_connected) {
-        return !is_repetition(elements_labels, element_tag) && nodes_connected.size() > 1;
+    size_t skip_white(string_view line, size_t &pos) {
+        size_t first = pos;
+        while (pos < line.size() && is_white(line[pos]))
+            pos++;
+        return pos - first;
     }
 
     /**
-    * @brief Inserts new element to the mapping structure.
+    * @brief Validates and tokenizes line in a single pass. Accepts exactly the language of templates:
+    * \s*T(0|[1-9]\d{0,8})\s+([A-Z]|\d)([A-Za-z0-9]|[,\-\/])*(\s+(0|[1-9]\d{0,8})){3}\s*
+    * \s*[DRCE](0|[1-9]\d{0,8})\s+([A-Z]|\d)([A-Za-z0-9]|[,\-\/])*(\s+(0|[1-9]\d{0,8})){2}\s*
     *
-    * @param[in, out] elements_types - structure containing mapping:
-    * {elements_types} -> {{element_label} -> {elements_tags_of_given_type_and_label}}
-    * @param[in] element_type - type of given element.
-    * @param[in] element_tag - tag of given element.
+    * @param[in] line - line to be scanned.
+    * @param[out] element - tokens of the line, valid only if true was returned.
+    * @return True if line describes an element, false otherwise.
     */
-    void insert_new_element_type_mapping(
-            unordered_map<string, unordered_map<char, set<string, cmp_by_string_length>>> &elements_types,
-            const string &element_type, const string &element_tag) {
-        char element_label = element_tag[0];
-        elements_types[element_type][element_label].insert(element_tag);
+    bool scan_element(string_view line, element_description &element) {
+        size_t pos = 0;
+        skip_white(line, pos);
+
+        if (pos == line.size())
+            return false;
+        switch (line[pos]) {
+            case 'T':
+                element.cnt_nodes = TRANSISTOR_NODES;
+                break;
+            case 'D': case 'R': case 'C': case 'E':
+                element.cnt_nodes = OTHER_ELEMENT_NODES;
+                break;
+            default:
+                return false;
+        }
+
+        element.label = line[pos++];
+        if (!scan_number(line, pos, element.number))
+            return false;
+
+        if (skip_white(line, pos) == 0 || pos == line.size() || !is_type_first_char(line[pos]))
+            return false;
+        size_t type_begin = pos++;
+        while (pos < line.size() && is_type_char(line[pos]))
+            pos++;
+        element.type = line.substr(type_begin, pos - type_begin);
+
+        for (int i = 0; i < element.cnt_nodes; i++) {
+            if (skip_white(line, pos) == 0 || !scan_number(line, pos, element.nodes[i]))
+                return false;
+        }
+
+        skip_white(line, pos);
+        return pos == line.size();
     }
 
+
     /**
-    * @brief Inserts new element to the mapping structue.
+    * @brief Sorts element's nodes and removes repetitions, cnt_nodes becomes number of different nodes.
     *
-    * @param[in, out] elements_labels - Structure containing mapping:
-    * {elements_labels} -> {{elements_tags} -> {elements_types}}
-    * @param[in] element_type - type of given element.
-    * @param[in] element_tag - tag of given element.
+    * @param[in, out] element - scanned element description.
     */
-    void insert_new_element_label_mapping(unordered_map<char, string_map> &elements_labels,
-                                          const string &element_type, const string &element_tag) {
-        char element_label = element_tag[0];
-        elements_labels[element_label][element_tag] = element_type;
+    void unique_nodes(element_description &element) {
+        sort(element.nodes, element.nodes + element.cnt_nodes);
+        element.cnt_nodes = unique(element.nodes, element.nodes + element.cnt_nodes) - element.nodes;
     }
 
     /**
-    * @brief Parses correct element description and adds necessary data to mapping structures.
-    * Assumption: element_description is correct description of some element: template-wise.
-    * Although element might be repetition, or list of nodes might contain repetitions, therefore
-    * it might still be incorrect.
+    * @brief Adds scanned element to the circuit if it meets requirements:
+    * Element's tag is not repetition = elements in circuit must be unique.
+    * Element's terminals have to be plugged into at least two different nodes.
+    * Element's nodes are deduplicated in place.
     *
-    * @throws wrong_input_exception if line contains input inconsistent with presumptions.
-    * @param[in, out] circuit_data - Tuple containing mapping structures which contain loaded data.
-    * @param[in] element_description - line describing new elemnt to be added.
-    * @param[in] cnt_line - parsed lines counter.
+    * @param[in, out] circuit - loaded data.
+    * @param[in, out] element - tokens of line describing new element to be added.
+    * @return True if element was added, false otherwise.
     */
-    void parse_element_description(mapping_structures &circuit_data, string &element_description, int cnt_line) {
-        string element_tag, element_type;
-        set<int> nodes_connected;
-        int node_id;
-        istringstream iss; iss.clear();
-        iss.str(element_description);
+    bool insert_element(circuit_data &circuit, element_description &element) {
+        unique_nodes(element);
+        element_key key = make_key(element.label, element.number);
 
-        iss >> element_tag >> element_type;
-        while (iss >> node_id)
-            nodes_connected.insert(node_id);
+        if (element.cnt_nodes < 2 || !circuit.tags.insert(key))
+            return false;
 
-        if (is_correct_data(get<0>(circuit_data), element_tag, nodes_connected)) {
-            insert_new_element_type_mapping(get<1>(circuit_data), element_type, element_tag);
-            insert_new_element_label_mapping(get<0>(circuit_data), element_type, element_tag);
-
-            for (int node_id : nodes_connected)
-                update_nodes_plugs(get<2>(circuit_data), node_id);
-        } else {
-            throw wrong_input_exception(element_description, cnt_line);
-        }
+        circuit.add(key, circuit.type_names.intern(element.type), element.nodes, element.cnt_nodes);
+        return true;
     }
 
     /**
-    * @brief String is considered "white" when it's empty or composed only of white characters.
+    * @brief Parses single line of input. Empty line is skipped, any other line has to describe an element.
+    * String composed only of white characters is incorrect.
     *
     * @throws wrong_input_exception if line contains input inconsistent with presumptions.
+    * @param[in, out] circuit - loaded data.
     * @param[in] line - line to be parsed.
     * @param[in] cnt_line - parsed lines counter.
-    * @return EMPTY_STRING if line was incorrect, empty or "white".
-    * Otherwise string following given template: ELEMENT_TOKEN ELEMENT_TYPE LIST_OF_NODES_CONNECTED_TO_IT'S_TERMINALS
     */
-    string parse_line(const string &line, int cnt_line,
-                      list<regex> &elements_data_regex, const regex &empty_string_regex) {
-        if (matches_any_template(line, elements_data_regex))
-            return line;
-        else if (matches_template(line, empty_string_regex))
-            return EMPTY_STRING;
+    void parse_line(circuit_data &circuit, string_view line, int cnt_line) {
+        element_description element;
 
-        throw wrong_input_exception(line, cnt_line);
+        if (scan_element(line, element)) {
+            if (!insert_element(circuit, element))
+                throw wrong_input_exception(string(line), cnt_line);
+        } else if (!line.empty()) {
+            throw wrong_input_exception(string(line), cnt_line);
+        }
     }
 
     /**
-    * @brief Returns tuple composed of three mapping structures containing read data: (A, B, C):
-    *
-    * A: unordered_map<char, string_map> elements_labels - u_map where key is element's label and value is string_map
-    * which contains mapping where keys are elements_tags and values are elements_types.
-    * Mapping: {elements_labels} -> {{elements_tags} -> {elements_types}}
-    *
-    * B: unordered_map<string, unordered_map<char, set<string>>> - u_map where key is element type and value is set containing
-    * element's tags of this element type. Mapping: {elements_types} ->
-    * {{element_label} > {elements_tags_of_given_type_and_label}}.
+    * @brief Reads the circuit from standard input.
     *
-    * C: map<int, int> - u_map where key is node's number and value is number of terminals
-    * plugged to that node. Mapping: {nodes_id} -> {#terminals_plugged_in}.
-    *
-    * @return Tuple composed of three mapping structures containing read data: (A, B, C):
+    * @param[out] errors - buffer to which incorrect lines are reported.
+    * @return Loaded data.
     */
-    mapping_structures read_data() {
-        mapping_structures circuit_data;
-        list<regex> elements_data_regex = create_regex_for_elements_data();
-        const regex empty_string_regex("^$");
+    circuit_data read_data(output_buffer &errors) {
+        circuit_data circuit;
+        line_reader input(stdin);
 
-        string line, element_description;
+        string_view line;
         int cnt_line = 0;
-        while (getline(cin, line)) {
+        while (input.next_line(line)) {
             cnt_line++;
 
             try {
-                element_description = parse_line(line, cnt_line, elements_data_regex, empty_string_regex);
-                if (!element_description.empty())
-                    parse_element_description(circuit_data, element_description, cnt_line);
+                parse_line(circuit, line, cnt_line);
             } catch (wrong_input_exception &e) {
-                cerr << e.what() << endl;
+                errors << e.what() << '\n';
             }
         }
 
-        return circuit_data;
+        return circuit;
     }
-} // End of namespace reader.
 
-namespace writer {
-    using namespace circuit_structures;
+    /**
+    * @brief Reads whole input in large blocks.
+    */
+    string read_all(FILE *input) {
+        constexpr size_t BLOCK_SIZE = 1 << 20;
+        string content;
+        size_t cnt_read;
 
-    enum Element {transistor = 'T', diode = 'D', resistor = 'R', condensator = 'C', power_source = 'E'};
+        do {
+            size_t old_size = content.size();
+            content.resize(old_size + BLOCK_SIZE);
+            cnt_read = fread(&content[old_size], 1, BLOCK_SIZE, input);
+            content.resize(old_size + cnt_read);
+        } while (cnt_read > 0);
 
-    using type_map = unordered_map<string, unordered_map<char, set<string, cmp_by_string_length>>>;
+        return content;
+    }
 
     /**
-    * @brief Lists all tags in given set in order.
-    *
-    * @param tags[in] - set of element tags.
+    * @brief Line of a chunk, line number is local to the chunk.
     */
-    void list_tags_from_set(set<string, cmp_by_string_length> &tags) {
-        bool first_tag = true;
+    struct chunk_line {
+        int line;
+        string_view text;
+    };
 
-        for (const string &tag : tags) {
-            if (first_tag) {
-                cout << tag;
-                first_tag = false;
-            } else {
-                cout << ", " << tag;
+    /**
+    * @brief Partial result of parsing a chunk of input - chunk is treated as if it were the whole input.
+    * Accepted elements might still turn out to be repetitions of elements from preceding chunks.
+    */
+    struct chunk_result {
+        circuit_data circuit;
+        vector<chunk_line> elements; /**< Lines of accepted elements, in the order of circuit's elements. */
+        vector<chunk_line> errors;
+        int cnt_lines = 0;
+    };
+
+    /**
+    * @brief Splits input into at most cnt_chunks chunks of similar size, chunk boundaries are placed just after '\n'.
+    */
+    vector<string_view> split_into_chunks(string_view input, size_t cnt_chunks) {
+        vector<string_view> chunks;
+        size_t chunk_size = input.size() / cnt_chunks + 1;
+        size_t begin = 0;
+
+        while (begin < input.size()) {
+            size_t end = min(input.size(), begin + chunk_size);
+            if (end < input.size()) {
+                end = input.find('\n', end - 1);
+                end = end == string_view::npos ? input.size() : end + 1;
             }
+            chunks.push_back(input.substr(begin, end - begin));
+            begin = end;
         }
+
+        return chunks;
     }
 
     /**
-    * @brief Lists all tags of given type and label and adds the type at the end o line.
-    *
-    * @param element[in] - enum corresponding to particular element label,
-    * @param type[in] - type of elements we want to list,
-    * @param element_types[in,out] - mapping of element types to sets of tag with given type.
+    * @brief Parses chunk of input into thread-local structures. Semantics are the same as in read_data,
+    * except that errors are stored instead of being printed.
     */
-    void list_tags_of_type_and_label(Element element, const string &type, type_map &element_types) {
-        auto iterator = element_types[type].find(element);
+    void parse_chunk(string_view chunk, chunk_result &result) {
+        size_t begin = 0;
+
+        while (begin < chunk.size()) {
+            size_t end = chunk.find('\n', begin);
+            if (end == string_view::npos)
+                end = chunk.size();
+            string_view line = chunk.substr(begin, end - begin);
+            begin = end + 1;
+            result.cnt_lines++;
 
-        if (iterator != element_types[type].end()) {
-            list_tags_from_set(element_types[type][element]);
-            cout << ": " << type << endl;
-            element_types[type].erase(element);
+            element_description element;
+            if (scan_element(line, element)) {
+                if (insert_element(result.circuit, element))
+                    result.elements.push_back({result.cnt_lines, line});
+                else
+                    result.errors.push_back({result.cnt_lines, line});
+            } else if (!line.empty()) {
+                result.errors.push_back({result.cnt_lines, line});
+            }
         }
     }
 
+    void report_error(const chunk_line &error, int first_line, output_buffer &errors) {
+        errors << "Error in line " << first_line + error.line << ": " << error.text << '\n';
+    }
+
     /**
-    * @brief Lists all elements of given label.
+    * @brief Appends partial result of a chunk to the circuit. Elements of the chunk which repeat elements
+    * of preceding chunks are reported, together with chunk's own errors, in the order of lines.
     *
-    * @param element_label[in] - enum corresponding to particular element label,
-    * @param data[in,out] - tuple containing data concerning the circuit.
+    * @param[in, out] circuit - data loaded from preceding chunks.
+    * @param[in] chunk - partial result of the chunk.
+    * @param[in] first_line - global number of the first line of the chunk minus one.
+    * @param[out] errors - buffer to which incorrect lines are reported.
     */
-    void list_element_items(Element element_label, mapping_structures &data) {
-        string_map elements_of_type = get<0>(data)[element_label];
+    void merge_chunk(circuit_data &circuit, const chunk_result &chunk, int first_line, output_buffer &errors) {
+        const circuit_data &partial = chunk.circuit;
+        vector<uint32_t> type_ids(partial.type_names.size());
+        for (uint32_t type = 0; type < type_ids.size(); type++)
+            type_ids[type] = circuit.type_names.intern(partial.type_names.name(type));
 
-        for (pair<string, string> element : elements_of_type)
-            list_tags_of_type_and_label(element_label, element.second, get<1>(data));
-    }
+        auto error = chunk.errors.begin();
+        for (size_t i = 0; i < partial.size(); i++) {
+            for (; error != chunk.errors.end() && error->line < chunk.elements[i].line; ++error)
+                report_error(*error, first_line, errors);
+
+            element_key key = partial.keys[i];
+            if (circuit.tags.insert(key)) {
+                uint32_t begin = partial.pins_begin[i];
+                circuit.add(key, type_ids[partial.types[i]], &partial.pins[begin], partial.pins_begin[i + 1] - begin);
+            } else {
+                report_error(chunk.elements[i], first_line, errors);
+            }
+        }
+        for (; error != chunk.errors.end(); ++error)
+            report_error(*error, first_line, errors);
+    }
+
+    /**
+    * @brief Parses input which has already been read. Input is split into chunks at line boundaries and chunks
+    * are parsed by a pool of cnt_threads threads, the calling thread included. Partial results are then merged
+    * in the order of chunks, therefore output and errors are identical to the ones of read_data.
+    */
+    circuit_data parse_input(string_view input, unsigned cnt_threads, output_buffer &errors) {
+        constexpr size_t CHUNKS_PER_THREAD = 4;
+        vector<string_view> chunks = split_into_chunks(input, cnt_threads == 1 ? 1 : cnt_threads * CHUNKS_PER_THREAD);
+        vector<chunk_result> results(chunks.size());
+
+        atomic<size_t> next_chunk{0};
+        auto worker = [&]() {
+            for (size_t i = next_chunk++; i < chunks.size(); i = next_chunk++)
+                parse_chunk(chunks[i], results[i]);
+        };
+        vector<thread> workers;
+        for (unsigned i = 1; i < cnt_threads; i++)
+            workers.emplace_back(worker);
+        worker();
+        for (thread &t : workers)
+            t.join();
+
+        circuit_data circuit;
+        int first_line = 0;
+        for (const chunk_result &result : results) {
+            merge_chunk(circuit, result, first_line, errors);
+            first_line += result.cnt_lines;
+        }
+
+        return circuit;
+    }
+
+    /**
+    * @brief Same as read_data, but input is read at once and parsed by parse_input.
+    */
+    circuit_data read_data_parallel(unsigned cnt_threads, output_buffer &errors) {
+        string input = read_all(stdin);
+        return parse_input(input, cnt_threads, errors);
+    }
+} // End of namespace reader.
+
+namespace analysis {
+    using namespace circuit_structures;
+
+    /**
+    * @brief Builds incidence graph of the circuit in linear time: (node, pin) pairs are radix sorted,
+    * consecutive runs of the same node become rows of the graph.
+    */
+    node_graph build_node_graph(const circuit_data &circuit) {
+        node_graph graph;
+        vector<uint32_t> pin_element(circuit.pins.size());
+        for (uint32_t element = 0; element < circuit.size(); element++)
+            fill(&pin_element[circuit.pins_begin[element]], &pin_element[0] + circuit.pins_begin[element + 1], element);
+
+        vector<uint64_t> packed(circuit.pins.size());
+        for (size_t pin = 0; pin < circuit.pins.size(); pin++)
+            packed[pin] = (uint64_t) circuit.pins[pin] << 32 | pin;
+        radix_sort(packed);
+
+        if (packed.empty() || packed[0] >> 32 != 0) {
+            graph.node_ids.push_back(0);
+            graph.elements_begin.push_back(0);
+        }
+        graph.pin_nodes.resize(circuit.pins.size());
+        graph.elements.reserve(packed.size());
+        for (size_t i = 0; i < packed.size(); i++) {
+            int node_id = packed[i] >> 32;
+            uint32_t pin = packed[i] & UINT32_MAX;
+            if (i == 0 || (int) (packed[i - 1] >> 32) != node_id) {
+                graph.node_ids.push_back(node_id);
+                graph.elements_begin.push_back(graph.elements.size());
+            }
+            graph.pin_nodes[pin] = graph.node_ids.size() - 1;
+            graph.elements.push_back(pin_element[pin]);
+        }
+        graph.elements_begin.push_back(graph.elements.size());
+
+        return graph;
+    }
+
+    /**
+    * @brief Disjoint sets with union by size and path halving.
+    */
+    class union_find {
+    private:
+        vector<uint32_t> parent;
+        vector<uint32_t> size;
+
+    public:
+        explicit union_find(size_t cnt) : parent(cnt), size(cnt, 1) {
+            for (uint32_t i = 0; i < cnt; i++)
+                parent[i] = i;
+        }
+
+        uint32_t find(uint32_t x) {
+            while (parent[x] != x)
+                x = parent[x] = parent[parent[x]];
+            return x;
+        }
+
+        bool unite(uint32_t a, uint32_t b) {
+            a = find(a);
+            b = find(b);
+            if (a == b)
+                return false;
+            if (size[a] < size[b])
+                swap(a, b);
+            parent[b] = a;
+            size[a] += size[b];
+            return true;
+        }
+    };
+
+    /**
+    * @brief Connects nodes of every element.
+    *
+    * @return Number of connected components of the circuit (node 0 always counts as a node).
+    */
+    size_t connect_components(const circuit_data &circuit, const node_graph &graph, union_find &components) {
+        size_t cnt_components = graph.cnt_nodes();
+
+        for (size_t element = 0; element < circuit.size(); element++)
+            for (uint32_t pin = circuit.pins_begin[element] + 1; pin < circuit.pins_begin[element + 1]; pin++)
+                cnt_components -= components.unite(graph.pin_nodes[circuit.pins_begin[element]], graph.pin_nodes[pin]);
+
+        return cnt_components;
+    }
+
+    size_t count_components(const circuit_data &circuit, const node_graph &graph) {
+        union_find components(graph.cnt_nodes());
+        return connect_components(circuit, graph, components);
+    }
+
+    /**
+    * @brief Marks nodes reachable from node 0 with breadth-first search over the incidence graph.
+    */
+    vector<bool> reachable_from_ground(const circuit_data &circuit, const node_graph &graph) {
+        vector<bool> node_visited(graph.cnt_nodes()), element_visited(circuit.size());
+        vector<uint32_t> queue = {0}; // Node 0 is the first node of the graph.
+        node_visited[0] = true;
+
+        for (size_t head = 0; head < queue.size(); head++) {
+            uint32_t node = queue[head];
+            for (uint32_t i = graph.elements_begin[node]; i < graph.elements_begin[node + 1]; i++) {
+                uint32_t element = graph.elements[i];
+                if (element_visited[element])
+                    continue;
+                element_visited[element] = true;
+
+                for (uint32_t pin = circuit.pins_begin[element]; pin < circuit.pins_begin[element + 1]; pin++) {
+                    if (!node_visited[graph.pin_nodes[pin]]) {
+                        node_visited[graph.pin_nodes[pin]] = true;
+                        queue.push_back(graph.pin_nodes[pin]);
+                    }
+                }
+            }
+        }
+
+        return node_visited;
+    }
 
     /**
-    * @brief Adds node number 0 to the map of nodes in the circuit if it is not already there.
+    * @brief Finds sub-circuits which are not connected with node 0.
     *
-    * @param nodes[in,out] - map of nodes in the circuit with number of elements connected to them.
+    * @return Smallest node id of every floating sub-circuit, in increasing order.
     */
-    void add_zero_to_nodes(map<int, int> &nodes) {
-        auto iterator = nodes.find(0);
+    vector<int> floating_subcircuits(const circuit_data &circuit, const node_graph &graph) {
+        union_find components(graph.cnt_nodes());
+        connect_components(circuit, graph, components);
+        vector<bool> grounded = reachable_from_ground(circuit, graph);
+        vector<bool> reported(graph.cnt_nodes());
+        vector<int> result;
+
+        for (uint32_t node = 0; node < graph.cnt_nodes(); node++) {
+            uint32_t root = components.find(node);
+            if (!grounded[node] && !reported[root]) {
+                reported[root] = true;
+                result.push_back(graph.node_ids[node]);
+            }
+        }
+
+        return result;
+    }
+
+    /**
+    * @brief Finds elements with at least two terminals plugged into the same node. Elements with all terminals
+    * in one node are rejected while reading, so only transistors can be reported.
+    *
+    * @return Keys of shorted elements, in the order of tags.
+    */
+    vector<element_key> shorted_elements(const circuit_data &circuit) {
+        vector<element_key> result;
+
+        for (size_t element = 0; element < circuit.size(); element++)
+            if ((int) circuit.cnt_pins(element) < cnt_terminals(circuit.keys[element]))
+                result.push_back(circuit.keys[element]);
+        radix_sort(result);
+
+        return result;
+    }
+} // End of the namespace analysis.
 
-        if (iterator == nodes.end())
-            nodes.insert(pair<int, int>(0, 0));
+namespace writer {
+    using namespace circuit_structures;
+    using output::output_buffer;
+
+    /**
+    * @brief Lists given elements of one type and adds the type at the end of line.
+    *
+    * @param circuit[in] - data concerning the circuit,
+    * @param first[in], last[in] - range of indices of elements in order of tags,
+    * @param out[out] - output buffer.
+    */
+    void list_group(const circuit_data &circuit, const uint32_t *first, const uint32_t *last, output_buffer &out) {
+        for (const uint32_t *it = first; it != last; ++it) {
+            if (it != first)
+                out << ", ";
+            out << key_label(circuit.keys[*it]) << key_number(circuit.keys[*it]);
+        }
+        out << ": " << circuit.type_names.name(circuit.types[*first]) << '\n';
     }
 
     /**
@@ -344,49 +1130,1361 @@ namespace writer {
     * Then within those categories are grouped by element types (each line is one element type)
     * and sorted by numbers in tags.
     *
-    * @param data[in,out] - tuple containing data concerning the circuit.
+    * @param circuit[in] - data concerning the circuit,
+    * @param groups[in] - elements of the circuit grouped in order of listing (see group_elements),
+    * @param out[out] - output buffer.
     */
-    void list_all_items(mapping_structures &data) {
-        Element elements[5] = {transistor, diode, resistor, condensator, power_source};
-
-        for (Element element : elements)
-            list_element_items(element, data);
+    void list_all_items(const circuit_data &circuit, const element_groups &groups, output_buffer &out) {
+        for (size_t group = 0; group < groups.cnt_groups(); group++)
+            list_group(circuit, groups.begin(group), groups.end(group), out);
     }
 
     /**
     * @brief Lists nodes in the circuit that are connected to one or less element.
+    * Node 0 is always part of the circuit. Terminals are counted by sorting all pins.
+    *
+    * @param circuit[in] - data concerning the circuit,
+    * @param out[out] - output buffer.
+    */
+    void list_warnings(const circuit_data &circuit, output_buffer &out) {
+        vector<uint64_t> nodes(circuit.pins.begin(), circuit.pins.end());
+        radix_sort(nodes);
+
+        bool no_warnings = true;
+        auto warn = [&no_warnings, &out](uint64_t node_id) {
+            if (no_warnings) {
+                out << "Warning, unconnected node(s): " << node_id;
+                no_warnings = false;
+            } else {
+                out << ", " << node_id;
+            }
+        };
+
+        if (nodes.empty() || nodes[0] != 0)
+            warn(0);
+        for (size_t i = 0; i < nodes.size(); i++) {
+            bool single = (i == 0 || nodes[i - 1] != nodes[i]) && (i + 1 == nodes.size() || nodes[i + 1] != nodes[i]);
+            if (single)
+                warn(nodes[i]);
+        }
+
+        if (!no_warnings)
+            out << '\n';
+    }
+
+    /**
+    * @brief Prints number of connected components of the circuit.
+    */
+    void list_components(const circuit_data &circuit, const node_graph &graph, output_buffer &out) {
+        out << "Connected components: " << analysis::count_components(circuit, graph) << '\n';
+    }
+
+    /**
+    * @brief Lists sub-circuits not connected with node 0, each one is represented by its smallest node.
+    */
+    void list_floating(const circuit_data &circuit, const node_graph &graph, output_buffer &out) {
+        vector<int> floating = analysis::floating_subcircuits(circuit, graph);
+
+        for (size_t i = 0; i < floating.size(); i++)
+            out << (i == 0 ? "Warning, floating sub-circuit(s) at node(s): " : ", ") << floating[i];
+        if (!floating.empty())
+            out << '\n';
+    }
+
+    /**
+    * @brief Lists elements with shorted terminals.
+    */
+    void list_shorted(const circuit_data &circuit, output_buffer &out) {
+        vector<element_key> shorted = analysis::shorted_elements(circuit);
+
+        for (size_t i = 0; i < shorted.size(); i++)
+            out << (i == 0 ? "Warning, shorted element(s): " : ", ") << key_label(shorted[i]) << key_number(shorted[i]);
+        if (!shorted.empty())
+            out << '\n';
+    }
+} // End of the namespace writer.
+
+
+
+namespace incremental {
+    using namespace circuit_structures;
+    using output::output_buffer;
+
+    enum class line_kind : uint8_t {empty, incorrect, element};
+
+    /**
+    * @brief What is known about a single line of the netlist. Element lines are syntactically correct,
+    * but only accepted ones are part of the circuit (others are repetitions or have less than two nodes).
+    */
+    struct line_record {
+        uint64_t hash;
+        element_key key;
+        uint32_t type;
+        int nodes[TRANSISTOR_NODES];
+        uint8_t cnt_nodes;
+        line_kind kind;
+        bool accepted;
+    };
+
+    /**
+    * @brief Sorted numbers of elements of one (label, type) group together with its rendered report line.
+    */
+    struct type_group {
+        vector<int> numbers;
+        string line;
+        bool dirty = true;
+    };
+
+    /**
+    * @brief State of the previous run, persisted between runs.
+    * Groups are keyed by (label index, type id), node_counts maps nodes to number of plugged terminals
+    * and weak_nodes contains nodes with less than two terminals.
+    */
+    struct netlist_index {
+        vector<line_record> lines;
+        type_table type_names;
+        map<uint64_t, type_group> groups;
+        map<int, uint32_t> node_counts;
+        set<int> weak_nodes;
+    };
+
+    constexpr char INDEX_MAGIC[8] = {'O', 'B', 'W', 'I', 'D', 'X', '0', '2'};
+
+    /**
+    * @brief FNV-1a hash of the line.
+    */
+    uint64_t hash_line(string_view line) {
+        uint64_t hash = 0xCBF29CE484222325ULL;
+        for (char c : line)
+            hash = (hash ^ (unsigned char) c) * 0x100000001B3ULL;
+        return hash;
+    }
+
+    /**
+    * @brief Splits input into lines with the semantics of getline.
+    */
+    vector<string_view> split_lines(string_view input) {
+        vector<string_view> lines;
+        size_t begin = 0;
+
+        while (begin < input.size()) {
+            size_t end = input.find('\n', begin);
+            if (end == string_view::npos)
+                end = input.size();
+            lines.push_back(input.substr(begin, end - begin));
+            begin = end + 1;
+        }
+
+        return lines;
+    }
+
+    /*
+      Index file consists of index_header followed by the payload, all integers are stored in native byte order:
+        uint64_t cnt_lines, line_record lines[cnt_lines],
+        uint64_t cnt_types, cnt_types strings,
+        uint64_t cnt_groups, cnt_groups times: uint64_t key, uint64_t cnt_numbers, int numbers[cnt_numbers], string,
+        uint64_t cnt_nodes, cnt_nodes times: int node_id, uint32_t cnt_plugs,
+      where a string is uint64_t size followed by its characters.
+    */
+
+    struct index_header {
+        char magic[8];
+        uint64_t payload_size;
+        uint64_t checksum;     /**< Hash of the payload. */
+    };
+
+    template<typename T>
+    void append_pod(string &payload, const T &value) {
+        payload.append(reinterpret_cast<const char *>(&value), sizeof(T));
+    }
+
+    void append_string(string &payload, const string &text) {
+        append_pod(payload, (uint64_t) text.size());
+        payload += text;
+    }
+
+    /**
+    * @brief Reads consecutive values of the payload, every read fails instead of reading past its end.
+    */
+    class payload_reader {
+    private:
+        string_view payload;
+
+    public:
+        explicit payload_reader(string_view payload) : payload(payload) {}
+
+        bool read_bytes(void *data, uint64_t size) {
+            if (size > payload.size())
+                return false;
+            memcpy(data, payload.data(), size);
+            payload.remove_prefix(size);
+            return true;
+        }
+
+        template<typename T>
+        bool read_pod(T &value) {
+            return read_bytes(&value, sizeof(T));
+        }
+
+        template<typename T>
+        bool read_array(vector<T> &values, uint64_t size) {
+            if (size > payload.size() / sizeof(T))
+                return false;
+            values.resize(size);
+            return read_bytes(values.data(), size * sizeof(T));
+        }
+
+        bool read_string(string &text) {
+            uint64_t size;
+            if (!read_pod(size) || size > payload.size())
+                return false;
+            text.assign(payload.data(), size);
+            payload.remove_prefix(size);
+            return true;
+        }
+
+        bool at_end() const {
+            return payload.empty();
+        }
+    };
+
+    /**
+    * @brief Checks that the record could have been produced by scan_line and update_index.
+    */
+    bool is_valid_record(const line_record &record, size_t cnt_types) {
+        uint8_t accepted;
+        memcpy(&accepted, reinterpret_cast<const char *>(&record) + offsetof(line_record, accepted), 1);
+        if (accepted > 1 || record.kind > line_kind::element || (accepted && record.kind != line_kind::element))
+            return false;
+        if (record.kind != line_kind::element)
+            return true;
+
+        if (record.key >> LABEL_SHIFT >= (element_key) CNT_ELEMENT_LABELS || record.type >= cnt_types
+            || record.cnt_nodes < 1 || record.cnt_nodes > cnt_terminals(record.key))
+            return false;
+        for (int i = 0; i < record.cnt_nodes; i++) {
+            if (record.nodes[i] < 0 || (i > 0 && record.nodes[i - 1] >= record.nodes[i]))
+                return false;
+        }
+        return true;
+    }
+
+    /**
+    * @brief Saves the index. Index is written to a temporary file which then replaces the old one,
+    * therefore interrupted run never leaves a corrupted index.
+    *
+    * @return True if index was saved, false otherwise.
+    */
+    bool save_index(const string &path, const netlist_index &index) {
+        string payload;
+        append_pod(payload, (uint64_t) index.lines.size());
+        payload.append(reinterpret_cast<const char *>(index.lines.data()), index.lines.size() * sizeof(line_record));
+
+        append_pod(payload, (uint64_t) index.type_names.size());
+        for (uint32_t type = 0; type < index.type_names.size(); type++)
+            append_string(payload, index.type_names.name(type));
+
+        append_pod(payload, (uint64_t) index.groups.size());
+        for (const auto &[key, group] : index.groups) {
+            append_pod(payload, key);
+            append_pod(payload, (uint64_t) group.numbers.size());
+            payload.append(reinterpret_cast<const char *>(group.numbers.data()), group.numbers.size() * sizeof(int));
+            append_string(payload, group.line);
+        }
+
+        append_pod(payload, (uint64_t) index.node_counts.size());
+        for (auto [node_id, cnt_plugs] : index.node_counts) {
+            append_pod(payload, node_id);
+            append_pod(payload, cnt_plugs);
+        }
+
+        index_header header;
+        memcpy(header.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC));
+        header.payload_size = payload.size();
+        header.checksum = hash_bytes(payload.data(), payload.size());
+
+        string temporary_path = path + ".tmp";
+        FILE *file = fopen(temporary_path.c_str(), "wb");
+        if (file == nullptr)
+            return false;
+
+        fwrite(&header, sizeof(header), 1, file);
+        fwrite(payload.data(), 1, payload.size(), file);
+
+        bool correct = !ferror(file);
+        correct &= fclose(file) == 0;
+        return correct && rename(temporary_path.c_str(), path.c_str()) == 0;
+    }
+
+    /**
+    * @brief Loads index saved by the previous run. Index is rejected unless its checksum matches and every
+    * record, type id, group and node count is in range, so a damaged index only costs a full scan of the input.
+    *
+    * @return True if index was loaded, false if it does not exist or is corrupted (index is then left empty).
+    */
+    bool load_index(const string &path, netlist_index &index) {
+        FILE *file = fopen(path.c_str(), "rb");
+        if (file == nullptr)
+            return false;
+
+        index_header header;
+        string payload;
+        bool correct = fread(&header, sizeof(header), 1, file) == 1
+                       && memcmp(header.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC)) == 0
+                       && header.payload_size < (1ULL << 40);
+        if (correct) {
+            payload.resize(header.payload_size);
+            correct = fread(&payload[0], 1, payload.size(), file) == payload.size() && fgetc(file) == EOF
+                      && header.checksum == hash_bytes(payload.data(), payload.size());
+        }
+        fclose(file);
+
+        auto fail = [&index]() {
+            index = netlist_index();
+            return false;
+        };
+        if (!correct)
+            return fail();
+
+        payload_reader reader(payload);
+        uint64_t size;
+        if (!reader.read_pod(size) || !reader.read_array(index.lines, size))
+            return fail();
+
+        string text;
+        if (!reader.read_pod(size))
+            return fail();
+        for (uint64_t type = 0; type < size; type++) {
+            // Repeated names would shift ids of the following types.
+            if (!reader.read_string(text) || index.type_names.intern(text) != type)
+                return fail();
+        }
+        for (const line_record &record : index.lines) {
+            if (!is_valid_record(record, index.type_names.size()))
+                return fail();
+        }
+
+        if (!reader.read_pod(size))
+            return fail();
+        for (uint64_t i = 0; i < size; i++) {
+            uint64_t key, cnt_numbers;
+            if (!reader.read_pod(key) || !reader.read_pod(cnt_numbers) || cnt_numbers == 0
+                || group_label_index(key) >= CNT_ELEMENT_LABELS || (key & UINT32_MAX) >= index.type_names.size()
+                || (!index.groups.empty() && index.groups.rbegin()->first >= key))
+                return fail();
+            type_group &group = index.groups.emplace_hint(index.groups.end(), key, type_group())->second;
+            if (!reader.read_array(group.numbers, cnt_numbers) || !reader.read_string(group.line)
+                || group.numbers[0] < 0 || adjacent_find(group.numbers.begin(), group.numbers.end(),
+                                                         greater_equal<int>()) != group.numbers.end())
+                return fail();
+            group.dirty = false;
+        }
+
+        if (!reader.read_pod(size))
+            return fail();
+        for (uint64_t i = 0; i < size; i++) {
+            int node_id;
+            uint32_t cnt_plugs;
+            if (!reader.read_pod(node_id) || !reader.read_pod(cnt_plugs) || node_id < 0 || cnt_plugs == 0
+                || (!index.node_counts.empty() && index.node_counts.rbegin()->first >= node_id))
+                return fail();
+            index.node_counts.emplace_hint(index.node_counts.end(), node_id, cnt_plugs);
+            if (cnt_plugs < 2)
+                index.weak_nodes.emplace_hint(index.weak_nodes.end(), node_id);
+        }
+
+        return reader.at_end() || fail();
+    }
+
+    /**
+    * @brief Scans a line which is new or has changed since the previous run.
+    */
+    line_record scan_line(netlist_index &index, string_view line) {
+        line_record record{};
+        record.hash = hash_line(line);
+        reader::element_description element;
+
+        if (reader::scan_element(line, element)) {
+            reader::unique_nodes(element);
+            record.kind = line_kind::element;
+            record.key = make_key(element.label, element.number);
+            record.type = index.type_names.intern(element.type);
+            record.cnt_nodes = element.cnt_nodes;
+            copy(element.nodes, element.nodes + element.cnt_nodes, record.nodes);
+        } else {
+            record.kind = line.empty() ? line_kind::empty : line_kind::incorrect;
+        }
+
+        return record;
+    }
+
+    /**
+    * @brief Applies changes of numbers of plugged terminals. Changes are aggregated per node first,
+    * so every changed node is looked up once.
+    *
+    * @param[in, out] index - updated index.
+    * @param[in, out] deltas - pairs (node, change of the number of its terminals).
+    */
+    void apply_node_changes(netlist_index &index, vector<pair<int, int>> &deltas) {
+        sort(deltas.begin(), deltas.end());
+
+        for (size_t i = 0; i < deltas.size();) {
+            int node_id = deltas[i].first, delta = 0;
+            for (; i < deltas.size() && deltas[i].first == node_id; i++)
+                delta += deltas[i].second;
+            if (delta == 0)
+                continue;
+
+            auto it = index.node_counts.try_emplace(index.node_counts.end(), node_id, 0);
+            it->second += delta;
+            if (it->second == 0) {
+                index.node_counts.erase(it);
+                index.weak_nodes.erase(node_id);
+            } else if (it->second < 2) {
+                index.weak_nodes.emplace_hint(index.weak_nodes.end(), node_id);
+            } else {
+                index.weak_nodes.erase(node_id);
+            }
+        }
+    }
+
+    /**
+    * @brief Numbers of elements removed from and added to a group.
+    */
+    struct group_change {
+        vector<int> removed;
+        vector<int> added;
+    };
+
+    /**
+    * @brief Records that accepted element is added (delta = 1) or removed (delta = -1).
+    */
+    void update_element(map<uint64_t, group_change> &changes, vector<pair<int, int>> &node_deltas,
+                        const line_record &record, int delta) {
+        group_change &change = changes[group_key(record.key, record.type)];
+        (delta > 0 ? change.added : change.removed).push_back(key_number(record.key));
+
+        for (int i = 0; i < record.cnt_nodes; i++)
+            node_deltas.emplace_back(record.nodes[i], delta);
+    }
+
+    /**
+    * @brief Applies changes to groups: time is linear in size of changed groups (plus sorting of the changes).
+    */
+    void apply_group_changes(netlist_index &index, map<uint64_t, group_change> &changes) {
+        vector<int> remaining, merged;
+
+        for (auto &[key, change] : changes) {
+            type_group &group = index.groups[key];
+            sort(change.removed.begin(), change.removed.end());
+            sort(change.added.begin(), change.added.end());
+
+            remaining.clear();
+            set_difference(group.numbers.begin(), group.numbers.end(), change.removed.begin(), change.removed.end(),
+                           back_inserter(remaining));
+            merged.clear();
+            std::merge(remaining.begin(), remaining.end(), change.added.begin(), change.added.end(),
+                       back_inserter(merged));
+            group.numbers.swap(merged);
+            group.dirty = true;
+
+            if (group.numbers.empty())
+                index.groups.erase(key);
+        }
+    }
+
+    /**
+    * @brief Updates the index to describe new netlist. Lines of common prefix and suffix of the old and new netlist
+    * are taken over from the index, only lines in between are scanned. Acceptance is recomputed only for tags which
+    * occur in changed lines and only elements whose acceptance changed are removed from / added to groups and nodes.
     *
-    * @param data[in,out] - tuple containing data concerning the circuit.
+    * @param[in, out] index - index of the previous run, after return: index of the new netlist.
+    * @param[in] lines - lines of the new netlist.
+    */
+    void update_index(netlist_index &index, const vector<string_view> &lines) {
+        vector<line_record> &old_lines = index.lines;
+        vector<uint64_t> hashes(lines.size());
+        for (size_t i = 0; i < lines.size(); i++)
+            hashes[i] = hash_line(lines[i]);
+
+        size_t prefix = 0;
+        while (prefix < old_lines.size() && prefix < lines.size() && old_lines[prefix].hash == hashes[prefix])
+            prefix++;
+        size_t suffix = 0;
+        while (suffix < old_lines.size() - prefix && suffix < lines.size() - prefix
+               && old_lines[old_lines.size() - 1 - suffix].hash == hashes[lines.size() - 1 - suffix])
+            suffix++;
+
+        key_set affected;
+        vector<line_record> new_lines;
+        new_lines.reserve(lines.size());
+        new_lines.insert(new_lines.end(), old_lines.begin(), old_lines.begin() + prefix);
+        for (size_t i = prefix; i < lines.size() - suffix; i++) {
+            new_lines.push_back(scan_line(index, lines[i]));
+            if (new_lines.back().kind == line_kind::element)
+                affected.insert(new_lines.back().key);
+        }
+        for (size_t i = prefix; i < old_lines.size() - suffix; i++) {
+            if (old_lines[i].kind == line_kind::element)
+                affected.insert(old_lines[i].key);
+        }
+        new_lines.insert(new_lines.end(), old_lines.end() - suffix, old_lines.end());
+
+        map<uint64_t, group_change> changes;
+        vector<pair<int, int>> node_deltas;
+        for (const line_record &record : old_lines)
+            if (record.accepted && affected.contains(record.key))
+                update_element(changes, node_deltas, record, -1);
+
+        key_set accepted;
+        for (line_record &record : new_lines) {
+            if (record.kind == line_kind::element && affected.contains(record.key)) {
+                record.accepted = record.cnt_nodes > 1 && accepted.insert(record.key);
+                if (record.accepted)
+                    update_element(changes, node_deltas, record, 1);
+            }
+        }
+
+        apply_group_changes(index, changes);
+        apply_node_changes(index, node_deltas);
+        old_lines.swap(new_lines);
+    }
+
+    void list_errors(const netlist_index &index, const vector<string_view> &lines, output_buffer &out) {
+        for (size_t i = 0; i < index.lines.size(); i++) {
+            const line_record &record = index.lines[i];
+            if (record.kind == line_kind::incorrect || (record.kind == line_kind::element && !record.accepted))
+                out << "Error in line " << i + 1 << ": " << lines[i] << '\n';
+        }
+    }
+
+    /**
+    * @brief Lists all elements like writer::list_all_items does. Only groups which changed are rendered again,
+    * lines of other groups are taken from the index.
     */
-    void list_warnings(mapping_structures &data) {
+    void list_all_items(netlist_index &index, output_buffer &out) {
+        vector<const type_group *> label_groups;
+
+        for (auto it = index.groups.begin(); it != index.groups.end();) {
+            uint64_t label = it->first >> 32;
+            label_groups.clear();
+            for (; it != index.groups.end() && it->first >> 32 == label; ++it) {
+                type_group &group = it->second;
+                if (group.dirty) {
+                    group.line.clear();
+                    for (int number : group.numbers) {
+                        if (!group.line.empty())
+                            group.line += ", ";
+                        group.line += ELEMENT_LABELS[label];
+                        group.line += to_string(number);
+                    }
+                    group.line += ": " + index.type_names.name(it->first & UINT32_MAX) + "\n";
+                    group.dirty = false;
+                }
+                label_groups.push_back(&group);
+            }
+
+            sort(label_groups.begin(), label_groups.end(), [](const type_group *a, const type_group *b) {
+                return a->numbers[0] < b->numbers[0];
+            });
+            for (const type_group *group : label_groups)
+                out << group->line;
+        }
+    }
+
+    void list_warnings(const netlist_index &index, output_buffer &out) {
         bool no_warnings = true;
+        auto warn = [&no_warnings, &out](int node_id) {
+            out << (no_warnings ? "Warning, unconnected node(s): " : ", ") << node_id;
+            no_warnings = false;
+        };
+
+        if (index.node_counts.count(0) == 0)
+            warn(0);
+        for (int node_id : index.weak_nodes)
+            warn(node_id);
+
+        if (!no_warnings)
+            out << '\n';
+    }
+
+    /**
+    * @brief Builds circuit of accepted elements, used by analyses.
+    */
+    circuit_data to_circuit(const netlist_index &index) {
+        circuit_data circuit;
+
+        for (uint32_t type = 0; type < index.type_names.size(); type++)
+            circuit.type_names.intern(index.type_names.name(type));
+        for (const line_record &record : index.lines) {
+            if (record.accepted) {
+                circuit.tags.insert(record.key);
+                circuit.add(record.key, record.type, record.nodes, record.cnt_nodes);
+            }
+        }
+
+        return circuit;
+    }
+} // End of the namespace incremental.
+
+namespace netlist_cache {
+    using namespace circuit_structures;
+    using output::output_buffer;
+
+    /*
+      Cache file consists of cache_header followed by the payload, all integers are stored in native byte order:
+        uint64_t type_offsets[cnt_types + 1]   - type i is type_chars[type_offsets[i]..type_offsets[i + 1]),
+        element_key keys[cnt_elements],
+        uint32_t types[cnt_elements],
+        uint32_t pins_begin[cnt_elements + 1],
+        int pins[cnt_pins],
+        char type_chars[],
+        char errors[errors_size]               - diagnostics of parsing, replayed on every cache hit.
+      Arrays are laid out in order of decreasing alignment, so every one of them is aligned in the mapped file.
+    */
+
+    constexpr char CACHE_MAGIC[8] = {'O', 'B', 'W', 'C', 'C', 'H', '0', '1'};
+
+    struct cache_header {
+        char magic[8];
+        uint64_t input_size;
+        uint64_t input_hash;   /**< Hash of the netlist the cache was built from. */
+        uint64_t cnt_types;
+        uint64_t cnt_type_chars;
+        uint64_t cnt_elements;
+        uint64_t cnt_pins;
+        uint64_t errors_size;
+        uint64_t checksum;     /**< Hash of the payload. */
+    };
+
+    uint64_t payload_size(const cache_header &header) {
+        return (header.cnt_types + 1) * sizeof(uint64_t)
+               + header.cnt_elements * (sizeof(element_key) + sizeof(uint32_t))
+               + (header.cnt_elements + 1) * sizeof(uint32_t) + header.cnt_pins * sizeof(int)
+               + header.cnt_type_chars + header.errors_size;
+    }
+
+    template<typename T>
+    void append_array(string &payload, const T *data, size_t size) {
+        payload.append(reinterpret_cast<const char *>(data), size * sizeof(T));
+    }
+
+    /**
+    * @brief Saves the circuit parsed from the input together with diagnostics. Cache is written to a temporary
+    * file which then replaces the old one, therefore interrupted run never leaves a corrupted cache.
+    *
+    * @return True if cache was saved, false otherwise.
+    */
+    bool save_cache(const string &path, string_view input, const circuit_data &circuit, string_view errors) {
+        vector<uint64_t> type_offsets = {0};
+        string type_chars;
+        for (uint32_t type = 0; type < circuit.type_names.size(); type++) {
+            type_chars += circuit.type_names.name(type);
+            type_offsets.push_back(type_chars.size());
+        }
+
+        string payload;
+        append_array(payload, type_offsets.data(), type_offsets.size());
+        append_array(payload, circuit.keys.data(), circuit.keys.size());
+        append_array(payload, circuit.types.data(), circuit.types.size());
+        append_array(payload, circuit.pins_begin.data(), circuit.pins_begin.size());
+        append_array(payload, circuit.pins.data(), circuit.pins.size());
+        payload += type_chars;
+        payload += errors;
+
+        cache_header header;
+        memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+        header.input_size = input.size();
+        header.input_hash = hash_bytes(input.data(), input.size());
+        header.cnt_types = circuit.type_names.size();
+        header.cnt_type_chars = type_chars.size();
+        header.cnt_elements = circuit.size();
+        header.cnt_pins = circuit.pins.size();
+        header.errors_size = errors.size();
+        header.checksum = hash_bytes(payload.data(), payload.size());
+
+        string temporary_path = path + ".tmp";
+        FILE *file = fopen(temporary_path.c_str(), "wb");
+        if (file == nullptr)
+            return false;
+
+        fwrite(&header, sizeof(header), 1, file);
+        fwrite(payload.data(), 1, payload.size(), file);
+
+        bool correct = !ferror(file);
+        correct &= fclose(file) == 0;
+        return correct && rename(temporary_path.c_str(), path.c_str()) == 0;
+    }
+
+    /**
+    * @brief Checks that the columns read from the cache could have been produced by parsing: pins of consecutive
+    * elements are consecutive, every element has a known label and type and at least two nodes, which are
+    * different, non-negative and sorted.
+    */
+    bool is_valid_circuit(const cache_header &header, const element_key *keys, const uint32_t *types,
+                          const uint32_t *pins_begin, const int *pins) {
+        // Offsets are checked first, so no pin is read out of range.
+        if (pins_begin[0] != 0 || pins_begin[header.cnt_elements] != header.cnt_pins)
+            return false;
+        for (uint64_t element = 0; element < header.cnt_elements; element++) {
+            if (pins_begin[element] >= pins_begin[element + 1])
+                return false;
+        }
+
+        for (uint64_t element = 0; element < header.cnt_elements; element++) {
+            uint32_t begin = pins_begin[element], end = pins_begin[element + 1];
+            if (keys[element] >> LABEL_SHIFT >= (element_key) CNT_ELEMENT_LABELS || types[element] >= header.cnt_types
+                || end - begin < 2 || end - begin > (uint32_t) cnt_terminals(keys[element]))
+                return false;
+            for (uint32_t pin = begin; pin < end; pin++) {
+                if (pins[pin] < 0 || (pin > begin && pins[pin - 1] >= pins[pin]))
+                    return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+    * @brief Maps the cache into memory and loads the circuit from it, if the cache was built from the same input.
+    * Columns of the circuit are views of the mapping, which the circuit keeps; only type names and diagnostics
+    * are copied. Besides the checksum, every offset, type id and pin of the mapped columns is checked, so a damaged
+    * cache only costs a full parse of the input.
+    *
+    * @param[out] errors - diagnostics of the input.
+    * @return True if cache was loaded, false if it does not exist, is corrupted or stale (circuit is then left empty).
+    */
+    bool load_cache(const string &path, string_view input, circuit_data &circuit, string &errors) {
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return false;
+
+        struct stat file_stat;
+        void *mapping = MAP_FAILED;
+        if (fstat(fd, &file_stat) == 0 && (size_t) file_stat.st_size >= sizeof(cache_header))
+            mapping = mmap(nullptr, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (mapping == MAP_FAILED)
+            return false;
+
+        size_t file_size = file_stat.st_size;
+        file_mapping mapped_file(mapping, file_size);
+        const char *file = mapped_file.bytes();
+        cache_header header;
+        memcpy(&header, file, sizeof(header));
+        const char *payload = file + sizeof(header);
+
+        bool correct = memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) == 0
+                       && header.input_size == input.size()
+                       && max({header.cnt_types, header.cnt_elements, header.cnt_pins}) < (1ULL << 32)
+                       && header.cnt_type_chars + header.errors_size < file_size
+                       && payload_size(header) == file_size - sizeof(header)
+                       && header.input_hash == hash_bytes(input.data(), input.size())
+                       && header.checksum == hash_bytes(payload, file_size - sizeof(header));
+
+        if (!correct)
+            return false;
+
+        auto next_array = [&payload](auto *&array, size_t size) {
+            array = reinterpret_cast<remove_reference_t<decltype(array)>>(payload);
+            payload += size * sizeof(*array);
+        };
+        const uint64_t *type_offsets;
+        const element_key *keys;
+        const uint32_t *types, *pins_begin;
+        const int *pins;
+        next_array(type_offsets, header.cnt_types + 1);
+        next_array(keys, header.cnt_elements);
+        next_array(types, header.cnt_elements);
+        next_array(pins_begin, header.cnt_elements + 1);
+        next_array(pins, header.cnt_pins);
+        string_view type_chars(payload, header.cnt_type_chars);
+
+        correct = type_offsets[0] == 0 && type_offsets[header.cnt_types] == header.cnt_type_chars;
+        for (uint64_t type = 0; correct && type < header.cnt_types; type++) {
+            uint64_t begin = type_offsets[type], end = type_offsets[type + 1];
+            // Repeated names would shift ids of the following types.
+            correct = begin <= end && end <= header.cnt_type_chars
+                      && circuit.type_names.intern(type_chars.substr(begin, end - begin)) == type;
+        }
+        correct = correct && is_valid_circuit(header, keys, types, pins_begin, pins);
+        if (!correct) {
+            circuit = circuit_data();
+            return false;
+        }
+
+        circuit.keys.view(keys, header.cnt_elements);
+        circuit.types.view(types, header.cnt_elements);
+        circuit.pins_begin.view(pins_begin, header.cnt_elements + 1);
+        circuit.pins.view(pins, header.cnt_pins);
+        errors.assign(payload + header.cnt_type_chars, header.errors_size);
+        circuit.mapping = move(mapped_file);
+        return true;
+    }
+
+    /**
+    * @brief Reads the circuit from standard input using the cache: on a cache hit the input is only hashed,
+    * otherwise it is parsed (by cnt_threads threads) and the cache is rebuilt.
+    * Diagnostics are the same in both cases.
+    */
+    circuit_data read_data(const string &path, unsigned cnt_threads, output_buffer &diagnostics) {
+        string input = reader::read_all(stdin);
+        circuit_data circuit;
+        string errors;
+
+        if (load_cache(path, input, circuit, errors)) {
+            diagnostics << errors;
+            return circuit;
+        }
+
+        output_buffer parse_errors;
+        circuit = reader::parse_input(input, cnt_threads, parse_errors);
+        diagnostics << parse_errors.view();
+        if (!save_cache(path, input, circuit, parse_errors.view()))
+            diagnostics << "Warning, cache could not be saved: " << path << '\n';
+
+        return circuit;
+    }
+} // End of the namespace netlist_cache.
+
+namespace hierarchy {
+    using namespace circuit_structures;
+    using output::output_buffer;
+
+    /*
+      Subcircuits are defined with:
+        .SUBCKT NAME PORT_1 ... PORT_k
+        element and instance lines
+        .ENDS [NAME]
+      and instantiated (at top level or inside a later definition) with: X<number> NAME NODE_1 ... NODE_k
+      Nodes of a definition are local, ports are connected to nodes given in the instance line. The exception
+      is node 0: it is the global ground, the same node in every definition and at the top level, as in SPICE.
+      Therefore 0 can not be a port of a definition.
+
+      Results are the ones of the flat run on the netlist flattened in this way:
+      - top level elements and nodes keep their tags and ids,
+      - every instance gets a block of consecutive numbers for every label and a block of consecutive node ids;
+        blocks of top level instances start just after the greatest top level number of the label (node id),
+      - within a block of a definition come its own elements in order of their numbers (own internal nodes
+        in increasing order, without node 0), followed by blocks of its instances in order of instance lines.
+      Expansion of a definition is summarized once, when the definition ends, so the flattened netlist
+      is never built - tags and nodes of instances are only enumerated when the report is written.
+    */
+
+    constexpr uint64_t NO_RANK = UINT64_MAX;
+
+    /**
+    * @brief Elements of one (label, type) group within the expansion of a definition. Ranks are positions within
+    * definition's block of numbers of the label (for the top level: numbers of tags).
+    */
+    struct group_summary {
+        uint64_t cnt = 0;
+        uint64_t first_rank = NO_RANK;
+        vector<uint64_t> own_ranks; /**< Ranks of definition's own elements, increasing. */
+    };
+
+    struct instance {
+        uint32_t definition;
+        vector<int> nodes;                           /**< Nodes connected to ports of the definition. */
+        uint64_t label_offset[CNT_ELEMENT_LABELS]{}; /**< Offset of instance's block of numbers of every label. */
+        uint64_t internal_offset = 0;                /**< Offset of instance's block of internal nodes. */
+    };
+
+    /**
+    * @brief Subcircuit definition or the top level, together with summary of its expansion.
+    */
+    struct definition {
+        string name;
+        vector<int> ports;
+        circuit_data elements; /**< Own elements, type ids refer to hierarchical_netlist::type_names. */
+        vector<instance> instances;
+        key_set instance_tags;
+        int line = 0; /**< Line of .SUBCKT. */
+
+        uint64_t cnt_label[CNT_ELEMENT_LABELS]{}; /**< Number of elements of every label in the expansion. */
+        map<uint64_t, group_summary> groups;      /**< Groups of the expansion, keyed by group_key. */
+        map<int, uint64_t> node_counts;           /**< Terminals plugged into local nodes in the expansion. */
+        vector<uint64_t> port_plugs;              /**< Terminals plugged into every port in the expansion. */
+        uint64_t ground_plugs = 0;                /**< Terminals plugged into node 0 in the expansion. */
+        vector<uint64_t> weak_internal;           /**< Offsets of own internal nodes with less than two terminals. */
+        uint64_t cnt_internal = 0;                /**< Internal nodes in the expansion. */
+        uint64_t cnt_weak = 0;                    /**< Internal nodes with less than two terminals in the expansion. */
+    };
+
+    struct hierarchical_netlist {
+        definition top;
+        vector<definition> subcircuits;
+        unordered_map<string, uint32_t> names;
+        type_table type_names;
+    };
+
+    /**
+    * @brief Computes summary of the expansion of the definition from summaries of its instances.
+    * Time is linear in size of the definition itself (plus number of groups of instantiated definitions).
+    */
+    void summarize(definition &def, const vector<definition> &subcircuits, bool top_level) {
+        const circuit_data &own = def.elements;
+        vector<uint32_t> order = sorted_elements(own);
+        uint64_t label_offset[CNT_ELEMENT_LABELS] = {};
+        int max_node = 0;
+
+        for (uint32_t element : order) {
+            int label = own.keys[element] >> LABEL_SHIFT;
+            uint64_t rank = top_level ? key_number(own.keys[element]) : def.cnt_label[label];
+            def.cnt_label[label]++;
+            label_offset[label] = top_level ? rank + 1 : def.cnt_label[label];
+
+            group_summary &group = def.groups[group_key(own.keys[element], own.types[element])];
+            group.cnt++;
+            group.first_rank = min(group.first_rank, rank);
+            group.own_ranks.push_back(rank);
+
+            for (uint32_t pin = own.pins_begin[element]; pin < own.pins_begin[element + 1]; pin++) {
+                def.node_counts[own.pins[pin]]++;
+                max_node = max(max_node, own.pins[pin]);
+            }
+        }
+        if (top_level)
+            for (uint64_t &offset : label_offset)
+                offset = max(offset, uint64_t(1));
+
+        for (instance &inst : def.instances) {
+            const definition &child = subcircuits[inst.definition];
+            for (int label = 0; label < CNT_ELEMENT_LABELS; label++) {
+                inst.label_offset[label] = label_offset[label];
+                label_offset[label] += child.cnt_label[label];
+                def.cnt_label[label] += child.cnt_label[label];
+            }
+
+            for (const auto &[key, child_group] : child.groups) {
+                group_summary &group = def.groups[key];
+                group.cnt += child_group.cnt;
+                group.first_rank = min(group.first_rank, inst.label_offset[group_label_index(key)] + child_group.first_rank);
+            }
+
+            for (size_t port = 0; port < child.ports.size(); port++) {
+                if (child.port_plugs[port] > 0)
+                    def.node_counts[inst.nodes[port]] += child.port_plugs[port];
+                max_node = max(max_node, inst.nodes[port]);
+            }
+            if (child.ground_plugs > 0)
+                def.node_counts[0] += child.ground_plugs;
+        }
+
+        uint64_t internal_offset = 0;
+        if (top_level) {
+            internal_offset = (uint64_t) max_node + 1;
+        } else {
+            vector<int> sorted_ports(def.ports);
+            sort(sorted_ports.begin(), sorted_ports.end());
+            for (auto [node_id, cnt_plugs] : def.node_counts) {
+                if (node_id == 0) {
+                    def.ground_plugs = cnt_plugs;
+                    continue;
+                }
+                if (binary_search(sorted_ports.begin(), sorted_ports.end(), node_id))
+                    continue;
+                if (cnt_plugs < 2)
+                    def.weak_internal.push_back(internal_offset);
+                internal_offset++;
+            }
+
+            for (int port : def.ports) {
+                auto it = def.node_counts.find(port);
+                def.port_plugs.push_back(it == def.node_counts.end() ? 0 : it->second);
+            }
+        }
+
+        def.cnt_weak = def.weak_internal.size();
+        for (instance &inst : def.instances) {
+            const definition &child = subcircuits[inst.definition];
+            inst.internal_offset = internal_offset;
+            internal_offset += child.cnt_internal;
+            def.cnt_weak += child.cnt_weak;
+        }
+        def.cnt_internal = top_level ? 0 : internal_offset;
+    }
 
-        add_zero_to_nodes(get<2>(data));
+    /**
+    * @brief Checks whether keyword (followed by white character or end of line) starts at pos, skips it if so.
+    */
+    bool scan_keyword(string_view line, size_t &pos, string_view keyword) {
+        if (line.substr(pos, keyword.size()) != keyword
+            || (pos + keyword.size() < line.size() && !reader::is_white(line[pos + keyword.size()])))
+            return false;
+        pos += keyword.size();
+        return true;
+    }
 
-        for (pair<int, int> element : get<2>(data)) {
-            if (element.second < 2) {
-                if (no_warnings) {
-                    cerr << "Warning, unconnected node(s): " << element.first;
-                    no_warnings = false;
-                } else {
-                    cerr << ", " << element.first;
+    /**
+    * @brief Scans name of subcircuit: [A-Za-z_][A-Za-z0-9_]* preceded by white characters.
+    */
+    bool scan_name(string_view line, size_t &pos, string_view &name) {
+        auto is_name_char = [](char c) {
+            return ('A' <= c && c <= 'Z') || ('a' <= c && c <= 'z') || c == '_' || reader::is_digit(c);
+        };
+
+        if (reader::skip_white(line, pos) == 0 || pos == line.size() || reader::is_digit(line[pos]))
+            return false;
+        size_t begin = pos;
+        while (pos < line.size() && is_name_char(line[pos]))
+            pos++;
+        name = line.substr(begin, pos - begin);
+
+        return !name.empty() && (pos == line.size() || reader::is_white(line[pos]));
+    }
+
+    /**
+    * @brief Scans list of different nodes, which lasts till the end of line.
+    */
+    bool scan_nodes(string_view line, size_t &pos, vector<int> &nodes) {
+        int node_id;
+
+        while (true) {
+            if (reader::skip_white(line, pos) == 0 || pos == line.size())
+                break;
+            if (!reader::scan_number(line, pos, node_id))
+                return false;
+            nodes.push_back(node_id);
+        }
+
+        vector<int> sorted_nodes(nodes);
+        sort(sorted_nodes.begin(), sorted_nodes.end());
+        return pos == line.size() && adjacent_find(sorted_nodes.begin(), sorted_nodes.end()) == sorted_nodes.end();
+    }
+
+    /**
+    * @brief Parses instance line: X<number> NAME NODE_1 ... NODE_k.
+    *
+    * @return True if instance is correct and has been added to the scope, false otherwise.
+    */
+    bool parse_instance(hierarchical_netlist &netlist, definition &scope, string_view line, size_t pos) {
+        int number;
+        string_view name;
+        instance inst;
+
+        pos++;
+        if (!reader::scan_number(line, pos, number) || !scan_name(line, pos, name)
+            || !scan_nodes(line, pos, inst.nodes))
+            return false;
+
+        auto it = netlist.names.find(string(name));
+        if (it == netlist.names.end() || netlist.subcircuits[it->second].ports.size() != inst.nodes.size()
+            || !scope.instance_tags.insert(number))
+            return false;
+
+        inst.definition = it->second;
+        scope.instances.push_back(move(inst));
+        return true;
+    }
+
+    /**
+    * @brief Parses element line into the scope, rules are the same as for flat netlist.
+    */
+    bool parse_element(hierarchical_netlist &netlist, definition &scope, string_view line) {
+        reader::element_description element;
+        if (!reader::scan_element(line, element))
+            return false;
+
+        reader::unique_nodes(element);
+        element_key key = make_key(element.label, element.number);
+        if (element.cnt_nodes < 2 || !scope.elements.tags.insert(key))
+            return false;
+
+        scope.elements.add(key, netlist.type_names.intern(element.type), element.nodes, element.cnt_nodes);
+        return true;
+    }
+
+    /**
+    * @brief Reads hierarchical netlist from standard input. Incorrect lines are reported in the order of lines.
+    * Incorrect or repeated definition is parsed (and its lines are checked) but it is not registered.
+    * Definitions can not be nested.
+    */
+    hierarchical_netlist read_data(output_buffer &errors) {
+        hierarchical_netlist netlist;
+        reader::line_reader input(stdin);
+        vector<pair<int, string>> incorrect_lines;
+        definition open;
+        string open_header; // .SUBCKT line of the open definition.
+        bool inside = false, discarded = false;
+
+        string_view line;
+        int cnt_line = 0;
+        while (input.next_line(line)) {
+            cnt_line++;
+            definition &scope = inside ? open : netlist.top;
+            size_t pos = 0;
+            reader::skip_white(line, pos);
+            bool correct = true;
+
+            if (scan_keyword(line, pos, ".SUBCKT")) {
+                string_view name;
+                vector<int> ports;
+                correct = !inside && scan_name(line, pos, name) && scan_nodes(line, pos, ports) && !ports.empty()
+                          && find(ports.begin(), ports.end(), 0) == ports.end()
+                          && netlist.names.count(string(name)) == 0;
+                if (!inside) {
+                    open = definition();
+                    open.name = name;
+                    open.ports = move(ports);
+                    open.line = cnt_line;
+                    open_header = line;
+                    inside = true;
+                    discarded = !correct;
+                }
+            } else if (scan_keyword(line, pos, ".ENDS")) {
+                size_t name_pos = pos;
+                reader::skip_white(line, pos);
+                if (pos < line.size()) {
+                    string_view name;
+                    pos = name_pos;
+                    correct = scan_name(line, pos, name) && name == open.name;
+                    reader::skip_white(line, pos);
+                }
+                correct = correct && inside && pos == line.size();
+                if (correct) {
+                    inside = false;
+                    if (!discarded) {
+                        summarize(open, netlist.subcircuits, false);
+                        netlist.names.emplace(open.name, netlist.subcircuits.size());
+                        netlist.subcircuits.push_back(move(open));
+                    }
                 }
+            } else if (pos < line.size() && line[pos] == 'X') {
+                correct = parse_instance(netlist, scope, line, pos);
+            } else if (!line.empty()) {
+                correct = parse_element(netlist, scope, line);
+            }
+
+            if (!correct)
+                incorrect_lines.emplace_back(cnt_line, line);
+        }
+
+        if (inside) {
+            incorrect_lines.emplace_back(open.line, open_header);
+            stable_sort(incorrect_lines.begin(), incorrect_lines.end(),
+                        [](const auto &a, const auto &b) { return a.first < b.first; });
+        }
+        for (const auto &[line_number, text] : incorrect_lines)
+            errors << "Error in line " << line_number << ": " << text << '\n';
+
+        summarize(netlist.top, netlist.subcircuits, true);
+        return netlist;
+    }
+
+    /**
+    * @brief Writes tags of the group which lie in the expansion of the definition, in increasing order.
+    *
+    * @param base - first number of definition's block of numbers of the label.
+    */
+    void list_group_tags(const hierarchical_netlist &netlist, const definition &def, uint64_t key, uint64_t base,
+                         bool &first_tag, output_buffer &out) {
+        auto group = def.groups.find(key);
+        if (group == def.groups.end())
+            return;
+
+        char element_label = ELEMENT_LABELS[group_label_index(key)];
+        for (uint64_t rank : group->second.own_ranks) {
+            out << (first_tag ? "" : ", ") << element_label << base + rank;
+            first_tag = false;
+        }
+        for (const instance &inst : def.instances)
+            list_group_tags(netlist, netlist.subcircuits[inst.definition], key,
+                            base + inst.label_offset[group_label_index(key)], first_tag, out);
+    }
+
+    /**
+    * @brief Lists all elements of the flattened netlist like writer::list_all_items does.
+    */
+    void list_all_items(const hierarchical_netlist &netlist, output_buffer &out) {
+        const definition &top = netlist.top;
+        vector<pair<uint64_t, uint64_t>> label_groups; // (first tag, group key)
+
+        for (auto it = top.groups.begin(); it != top.groups.end();) {
+            int label = group_label_index(it->first);
+            label_groups.clear();
+            for (; it != top.groups.end() && group_label_index(it->first) == label; ++it)
+                label_groups.emplace_back(it->second.first_rank, it->first);
+            sort(label_groups.begin(), label_groups.end());
+
+            for (auto [first_rank, key] : label_groups) {
+                bool first_tag = true;
+                list_group_tags(netlist, top, key, 0, first_tag, out);
+                out << ": " << netlist.type_names.name(key & UINT32_MAX) << '\n';
             }
         }
+    }
+
+    /**
+    * @brief Writes internal nodes of the expansion with less than two terminals, in increasing order.
+    *
+    * @param base - first id of definition's block of internal nodes.
+    */
+    void list_weak_internal(const hierarchical_netlist &netlist, const definition &def, uint64_t base,
+                            const function<void(uint64_t)> &warn) {
+        for (uint64_t offset : def.weak_internal)
+            warn(base + offset);
+        for (const instance &inst : def.instances) {
+            const definition &child = netlist.subcircuits[inst.definition];
+            if (child.cnt_weak > 0)
+                list_weak_internal(netlist, child, base + inst.internal_offset, warn);
+        }
+    }
+
+    /**
+    * @brief Lists nodes of the flattened netlist with less than two terminals like writer::list_warnings does.
+    */
+    void list_warnings(const hierarchical_netlist &netlist, output_buffer &out) {
+        const definition &top = netlist.top;
+        bool no_warnings = true;
+        auto warn = [&no_warnings, &out](uint64_t node_id) {
+            out << (no_warnings ? "Warning, unconnected node(s): " : ", ") << node_id;
+            no_warnings = false;
+        };
+
+        if (top.node_counts.count(0) == 0)
+            warn(0);
+        for (auto [node_id, cnt_plugs] : top.node_counts)
+            if (cnt_plugs < 2)
+                warn(node_id);
+        for (const instance &inst : top.instances) {
+            const definition &child = netlist.subcircuits[inst.definition];
+            if (child.cnt_weak > 0)
+                list_weak_internal(netlist, child, inst.internal_offset, warn);
+        }
 
         if (!no_warnings)
-            cerr << endl;
+            out << '\n';
     }
-} // End of the namespace writer.
+} // End of the namespace hierarchy.
 
+namespace options {
+    /**
+    * @brief Program options given in command line.
+    */
+    struct program_options {
+        unsigned cnt_threads = 1; /**< -j N: number of threads parsing the input. */
+        bool components = false;  /**< --components: print number of connected components. */
+        bool floating = false;    /**< --floating: warn about sub-circuits not connected with node 0. */
+        bool shorted = false;     /**< --shorted: warn about elements with shorted terminals. */
+        string index_path;        /**< --incremental FILE: index of the previous run, empty if not given. */
+        bool hierarchical = false; /**< --hierarchical: accept subcircuit definitions and instances. */
+        string cache_path;         /**< --cache FILE: binary cache of the parsed netlist, empty if not given. */
+    };
 
+    void print_usage(const char *program_name) {
+        cerr << "Usage: " << program_name << " [-j THREADS] [--components] [--floating] [--shorted]"
+             << " [--incremental INDEX_FILE | --cache CACHE_FILE]" << endl
+             << "       " << program_name << " --hierarchical" << endl;
+    }
 
-int main() {
-    circuit_structures::mapping_structures data;
+    /**
+    * @brief Parses command line arguments.
+    *
+    * @param[out] options - parsed options.
+    * @return False if arguments are incorrect, true otherwise.
+    */
+    bool parse_options(int argc, char *argv[], program_options &options) {
+        for (int i = 1; i < argc; i++) {
+            string_view arg = argv[i];
 
-    data = reader::read_data();
-    writer::list_all_items(data);
-    writer::list_warnings(data);
+            if (arg == "-j" && i + 1 < argc) {
+                char *end;
+                long cnt_threads = strtol(argv[++i], &end, 10);
+                if (*end != '\0' || cnt_threads < 1 || cnt_threads > 1024)
+                    return false;
+                options.cnt_threads = cnt_threads;
+            } else if (arg == "--components") {
+                options.components = true;
+            } else if (arg == "--floating") {
+                options.floating = true;
+            } else if (arg == "--shorted") {
+                options.shorted = true;
+            } else if (arg == "--incremental" && i + 1 < argc) {
+                options.index_path = argv[++i];
+            } else if (arg == "--cache" && i + 1 < argc) {
+                options.cache_path = argv[++i];
+            } else if (arg == "--hierarchical") {
+                options.hierarchical = true;
+            } else {
+                return false;
+            }
+        }
+
+        // Hierarchical netlist is never flattened, therefore it can not be analysed, indexed nor cached.
+        if (options.hierarchical)
+            return options.cnt_threads == 1 && options.index_path.empty() && options.cache_path.empty()
+                   && !options.components && !options.floating && !options.shorted;
+        return options.index_path.empty() || options.cache_path.empty();
+    }
+} // End of the namespace options.
+
+int main(int argc, char *argv[]) {
+    options::program_options program_options;
+    if (!options::parse_options(argc, argv, program_options)) {
+        options::print_usage(argv[0]);
+        return 1;
+    }
+
+    // Whole output goes through output buffers, iostreams are not used for it.
+    ios_base::sync_with_stdio(false);
+    output::output_buffer report(STDOUT_FILENO), diagnostics(STDERR_FILENO);
+
+    if (program_options.hierarchical) {
+        hierarchy::hierarchical_netlist netlist = hierarchy::read_data(diagnostics);
+        diagnostics.flush();
+        hierarchy::list_all_items(netlist, report);
+        report.flush();
+        hierarchy::list_warnings(netlist, diagnostics);
+        return 0;
+    }
+
+    bool incremental_mode = !program_options.index_path.empty();
+    bool any_analysis = program_options.components || program_options.floating || program_options.shorted;
+    circuit_structures::circuit_data data;
+    incremental::netlist_index index;
+    string input;
+    vector<string_view> lines;
+
+    if (incremental_mode) {
+        input = reader::read_all(stdin);
+        lines = incremental::split_lines(input);
+        incremental::load_index(program_options.index_path, index);
+        incremental::update_index(index, lines);
+        incremental::list_errors(index, lines, diagnostics);
+        if (any_analysis)
+            data = incremental::to_circuit(index);
+    } else if (!program_options.cache_path.empty()) {
+        data = netlist_cache::read_data(program_options.cache_path, program_options.cnt_threads, diagnostics);
+    } else if (program_options.cnt_threads > 1) {
+        data = reader::read_data_parallel(program_options.cnt_threads, diagnostics);
+    } else {
+        data = reader::read_data(diagnostics);
+    }
+    diagnostics.flush();
+
+    circuit_structures::node_graph graph;
+    if (program_options.components || program_options.floating)
+        graph = analysis::build_node_graph(data);
+
+    if (incremental_mode)
+        incremental::list_all_items(index, report);
+    else
+        writer::list_all_items(data, circuit_structures::group_elements(data), report);
+    if (program_options.components)
+        writer::list_components(data, graph, report);
+    report.flush();
+
+    if (incremental_mode)
+        incremental::list_warnings(index, diagnostics);
+    else
+        writer::list_warnings(data, diagnostics);
+    if (program_options.floating)
+        writer::list_floating(data, graph, diagnostics);
+    if (program_options.shorted)
+        writer::list_shorted(data, diagnostics);
+
+    if (incremental_mode && !incremental::save_index(program_options.index_path, index))
+        diagnostics << "Warning, index could not be saved: " << program_options.index_path << '\n';
 
     return 0;
-}
\ No newline at end of file
+}
@@ -1,10 +1,20 @@
 // Ten przykład celowo łamie reguły dobrego stylu kodowania.
 
 #include "tst.h"
+#include "frozen_tst.h"
+#include <algorithm>
 #include <cassert>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <iterator>
 #include <stdexcept>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
 
 using namespace std;
 using namespace Detail;
@@ -132,6 +142,241 @@ example6() {
     std::cout << "End of example 6.\n";
 }
 
+void
+example7()
+{
+    // Insertion walks down iteratively: a word may be a prefix or an extension of existing ones.
+    assert((TST<>("cat") + "catalog").exist("cat"));
+    assert((TST<>("catalog") + "cat").exist("catalog"));
+    assert((TST<>("catalog") + "cat").exist("cat"));
+    assert(!(TST<>("catalog") + "cat").exist("cata"));
+    assert((TST<>("catalog") + "cat").size() == 7);
+    assert((TST<>("cat") + "cat").size() == 3);
+    assert((TST<>("cat") + "").size() == 3);
+
+    // Degenerate spines: every word a prefix of the next one (center spine), and distinct characters
+    // in increasing order (right spine).
+    TST<> center_spine{};
+    std::string word;
+    for (int i = 0; i < 2000; i++) {
+        word += 'a';
+        center_spine = center_spine + word;
+    }
+    assert(center_spine.size() == 2000);
+    assert(center_spine.exist(word) && center_spine.exist(std::string(1000, 'a')));
+    assert(!center_spine.exist(word + 'a'));
+    assert(center_spine.prefix(word + 'b') == word);
+
+    TST<char32_t> right_spine{};
+    for (char32_t c = 1; c <= 5000; c++)
+        right_spine = right_spine + std::u32string(1, c);
+    assert(right_spine.size() == 5000);
+    assert(right_spine.exist(std::u32string(1, 5000)) && !right_spine.exist(std::u32string(1, 5001)));
+    assert(right_spine.right().value() == 2 && right_spine.left().empty());
+
+    // A long key is built, searched, folded and released without a stack frame per character.
+    std::string long_key(1000000, 'x');
+    long_key.back() = 'y';
+    TST<> long_tree = TST<>(long_key) + "xx";
+    assert(long_tree.exist(long_key) && long_tree.exist("xx") && !long_tree.exist("xxx"));
+    assert(long_tree.prefix(long_key + "z") == long_key);
+    assert(long_tree.size() == long_key.size());
+    assert(long_tree.fold(0, [](int acc, char c) { return acc + (c == 'y'); }) == 1);
+
+    std::cout << "End of example 7.\n";
+}
+
+void
+example8()
+{
+    std::vector<std::string> words = {"", "", "as", "at", "cup", "cute", "cute", "he", "i", "us"};
+    TST<> built = TST<>::from_sorted(words);
+    // Empty words are skipped and repeated words stored once: the same nodes as inserting one by one.
+    TST<> inserted = TST<>("as") + "at" + "cup" + "cute" + "he" + "i" + "us";
+    assert(built.size() == inserted.size());
+    for (const std::string& w : words)
+        assert(built.exist(w) == !w.empty());
+    assert(!built.exist("cu") && !built.exist("c"));
+    assert(built.prefix("cur") == "cu");
+    // The median word's first character is the root.
+    assert(built.value() == 'c');
+
+    assert(TST<>::from_sorted(std::vector<std::string>{}).empty());
+    assert(TST<>::from_sorted(std::vector<std::string>{"", ""}).empty());
+    const char* c_strings[] = {"ab", "abc", "b"};
+    assert(TST<>::from_sorted(c_strings).exist("abc"));
+
+    try {
+        TST<>::from_sorted(std::vector<std::string>{"b", "a"});
+        assert(false);
+    } catch (const std::invalid_argument&) {
+    }
+    try {
+        TST<>::from_sorted(std::vector<std::string>{"ab", "a"});
+        assert(false);
+    } catch (const std::invalid_argument&) {
+    }
+
+    // Subtrees built by several threads make the same tree.
+    std::vector<std::string> many;
+    for (int i = 0; i < 10000; i++)
+        many.push_back(std::to_string(i));
+    std::sort(many.begin(), many.end());
+    TST<> sequential = TST<>::from_sorted(many);
+    TST<> parallel = TST<>::from_sorted(many, 4);
+    assert(sequential.size() == parallel.size());
+    assert(sequential.fold(std::string(), [](std::string acc, char c) { return acc + c; })
+           == parallel.fold(std::string(), [](std::string acc, char c) { return acc + c; }));
+    for (const std::string& w : many)
+        assert(parallel.exist(w));
+
+    std::cout << "End of example 8.\n";
+}
+
+std::string
+read_file(const std::string& path)
+{
+    std::ifstream in(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+void
+example9()
+{
+    TST<> tst = TST<>("cute") + "cup" + "at" + "as" + "he" + "us" + "i";
+    FrozenTST<> frozen(tst);
+    assert(frozen.size() == tst.size());
+    assert(frozen.exist("cup") && frozen.exist(std::string("i")) && !frozen.exist("cu") && !frozen.exist(""));
+    assert(frozen.prefix("cur") == "cu" && frozen.prefix(std::string("atr")) == "at");
+    assert(FrozenTST<>(TST<>()).empty() && !FrozenTST<>().exist("a"));
+
+    const std::string path = (std::filesystem::temp_directory_path() / "tst_example.frozen").string();
+    frozen.save(path);
+    FrozenTST<> opened(path);
+    assert(opened.size() == tst.size());
+    for (const char* w : {"cute", "cup", "at", "as", "he", "us", "i", "c", "cuter", "x"}) {
+        assert(opened.exist(w) == tst.exist(w));
+        assert(opened.prefix(w) == tst.prefix(w));
+    }
+    // Equal trees give byte-identical files.
+    std::string saved = read_file(path);
+    FrozenTST<>(TST<>("cute") + "cup" + "at" + "as" + "he" + "us" + "i").save(path);
+    assert(read_file(path) == saved);
+
+    // A valid file of another character type is rejected.
+    try {
+        FrozenTST<char16_t> bad(path);
+        assert(false);
+    } catch (const std::runtime_error&) {
+    }
+
+    // A file with a child outside the array is rejected.
+    std::string broken = saved;
+    broken[broken.size() - 4] = '\x7f';
+    std::ofstream(path, std::ios::binary | std::ios::trunc) << broken;
+    try {
+        FrozenTST<> bad(path);
+        assert(false);
+    } catch (const std::runtime_error&) {
+    }
+    std::remove(path.c_str());
+
+    std::cout << "End of example 9.\n";
+}
+
+void
+example10()
+{
+    TST<> tst = TST<>("cute") + "cup" + "at" + "as" + "he" + "us" + "i" + "cu";
+    std::vector<std::string> all;
+    for (std::string_view w : tst.words())
+        all.emplace_back(w);
+    assert((all == std::vector<std::string>{"as", "at", "cu", "cup", "cute", "he", "i", "us"}));
+
+    // The prefix itself is a word too.
+    assert((tst.words_with_prefix("cu") == std::vector<std::string>{"cu", "cup", "cute"}));
+    assert((tst.words_with_prefix("cup") == std::vector<std::string>{"cup"}));
+    assert((tst.words_with_prefix("c") == std::vector<std::string>{"cu", "cup", "cute"}));
+    assert(tst.words_with_prefix("cut") == std::vector<std::string>{"cute"});
+    assert(tst.words_with_prefix("x").empty() && tst.words_with_prefix("cuter").empty());
+    assert((tst.words_with_prefix("", 2) == std::vector<std::string>{"as", "at"}));
+    assert(tst.words_with_prefix("cu", 0).empty());
+    assert(TST<>().words().begin() == TST<>().words().end());
+    assert(TST<>().words_with_prefix("a").empty() && TST<>().top_k("", 3).empty());
+
+    // The iterator shares the nodes it walks, so it outlives the tree.
+    auto it = TST<>("dog").words().begin();
+    assert(*it == "dog" && ++it == TST<>::WordIterator());
+
+    // add sets the weight of a new or an existing word; operator+ keeps it.
+    TST<> weighted = TST<>().add("cup", 5).add("cute", 9).add("cu", 1).add("at", 7) + "as";
+    assert(weighted.size() == 8);
+    assert(weighted.add("cup", 2).size() == weighted.size());
+    assert(weighted.add("cup", 2).words_with_prefix("") == weighted.words_with_prefix(""));
+    typedef std::vector<std::pair<std::string, TST<>::Weight>> Ranking;
+    assert((weighted.top_k("", 3) == Ranking{{"cute", 9}, {"at", 7}, {"cup", 5}}));
+    assert((weighted.top_k("cu", 5) == Ranking{{"cute", 9}, {"cup", 5}, {"cu", 1}}));
+    assert((weighted.add("cup", 20).top_k("cu", 1) == Ranking{{"cup", 20}}));
+    assert(((weighted + "cup").top_k("cup", 1) == Ranking{{"cup", 5}}));
+    assert(weighted.top_k("", 10).size() == 5 && weighted.top_k("", 10).back() == std::make_pair(std::string("as"), 0u));
+    assert(weighted.top_k("cu", 0).empty() && weighted.top_k("x", 2).empty());
+
+    std::cout << "End of example 10.\n";
+}
+
+void
+example11()
+{
+    typedef TST<char, PooledNodes> Pooled;
+
+    // Copies, subtrees and versions share the pool of the tree they come from, and keep its nodes alive.
+    Pooled base = Pooled("cute") + "cup" + "at";
+    Pooled copy = base;
+    Pooled version = copy + "as" + "he";
+    Pooled subtree = version.center();
+    base = Pooled();
+    assert(copy.size() == 7 && copy.exist("cup") && !copy.exist("as"));
+    assert(version.size() == 10 && version.exist("as") && version.exist("cute"));
+    assert(subtree.value() == 'u' && subtree.exist("ute") && subtree.exist("up"));
+    copy = Pooled();
+    version = Pooled();
+    assert(subtree.exist("ute") && subtree.size() == 4);
+    auto it = Pooled("dog").words().begin();
+    assert(*it == "dog" && ++it == Pooled::WordIterator());
+
+    // Versions released over and over give their slots to the next ones, the kept tree stays intact.
+    Pooled kept = Pooled::from_sorted(std::vector<std::string>{"a", "ab", "b", "c"});
+    for (int i = 0; i < 100000; i++) {
+        Pooled temporary = kept.add(std::to_string(i), i) + "abc";
+        assert(temporary.exist(std::to_string(i)) && temporary.top_k("", 1).front().second == Pooled::Weight(i));
+    }
+    assert(kept.size() == 4 && kept.words_with_prefix("") == (std::vector<std::string>{"a", "ab", "b", "c"}));
+
+    // A long chain is released without a stack frame per node.
+    std::string long_key(1000000, 'x');
+    assert(Pooled(long_key).prefix(long_key) == long_key);
+
+    // Separate trees have separate pools, so threads may build them at the same time.
+    std::vector<std::string> built(4);
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < built.size(); t++) {
+        threads.emplace_back([&built, t] {
+            Pooled tree;
+            for (int i = 0; i < 2000; i++)
+                tree = tree + std::to_string(i * built.size() + t);
+            Pooled kept_version = tree;
+            for (int i = 0; i < 2000; i += 2)
+                tree = tree.add(std::to_string(i * built.size() + t), i);
+            built[t] = kept_version.words_with_prefix(std::to_string(t)).front() + ' ' + tree.top_k("", 1).front().first;
+        });
+    }
+    for (std::thread& thread : threads)
+        thread.join();
+    assert((built == std::vector<std::string>{"0 7992", "1 7993", "2 7994", "3 7995"}));
+
+    std::cout << "End of example 11.\n";
+}
+
 int main()
 {
     example1();
@@ -140,4 +385,9 @@ int main()
     example4();
     example5();
     example6();
+    example7();
+    example8();
+    example9();
+    example10();
+    example11();
 }
@@ -0,0 +1,340 @@
+#ifndef FROZEN_TST_H
+#define FROZEN_TST_H
+
+#include "tst.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <initializer_list>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/**
+ * Read-only snapshot of a TST: all nodes in one array, in breadth-first order, referring to their children by
+ * 32-bit positions. The root is at position 0, so 0 also stands for a missing child. Lookups touch only this
+ * array - no reference counts and no pointers - and the upper levels, visited by every lookup, share a few
+ * cache lines. The array can be saved to a file and mapped back into memory without any parsing.
+ */
+template<typename C = char>
+class FrozenTST {
+    static_assert(std::is_trivially_copyable_v<C>, "C must be trivially copyable");
+
+    struct Node {
+        static constexpr uint8_t kEndOfWord = 1;
+
+        C data;
+        uint8_t flags;
+        uint32_t left;
+        uint32_t center;
+        uint32_t right;
+    };
+
+    static constexpr uint32_t kNoChild = 0;
+
+    /**
+     * Header of a frozen tree file. The nodes follow it at offset nodes, written in the byte order
+     * of the machine which saved the file.
+     */
+    struct Header {
+        static constexpr char kMagic[8] = {'F', 'R', 'O', 'Z', 'N', 'T', 'S', 'T'};
+        static constexpr uint32_t kFormatVersion = 1;
+        static constexpr uint64_t kAlignment = 64;
+
+        char magic[8];
+        uint32_t format_version;
+        uint16_t char_size;
+        uint16_t node_size;
+        uint64_t cnt_nodes;
+        uint64_t nodes;
+        uint64_t file_size;
+    };
+
+    /**
+     * Memory mapping of a file, unmapped by the destructor.
+     */
+    class Mapping {
+        void* data = nullptr;
+        size_t size = 0;
+
+    public:
+        Mapping() noexcept = default;
+
+        Mapping(void* data, size_t size) noexcept
+        : data(data)
+        , size(size)
+        {}
+
+        Mapping(Mapping&& other) noexcept
+        : data(std::exchange(other.data, nullptr))
+        , size(std::exchange(other.size, 0))
+        {}
+
+        Mapping& operator=(Mapping&& other) noexcept {
+            std::swap(data, other.data);
+            std::swap(size, other.size);
+            return *this;
+        }
+
+        ~Mapping() {
+            if (data)
+                munmap(data, size);
+        }
+
+        const char* bytes() const noexcept {
+            return static_cast<const char*>(data);
+        }
+    };
+
+    std::vector<Node> owned; // Empty for a mapped file.
+    Mapping mapping;
+    const Node* nodes = nullptr;
+    uint64_t cnt_nodes = 0;
+
+    static constexpr uint64_t kNodesPerChunk = 4096;
+
+    /**
+     * Copies the fields of node to bytes, leaving the padding between them as it is.
+     */
+    static void copy_fields(char* bytes, const Node& node) {
+        std::memcpy(bytes + offsetof(Node, data), &node.data, sizeof(node.data));
+        std::memcpy(bytes + offsetof(Node, flags), &node.flags, sizeof(node.flags));
+        std::memcpy(bytes + offsetof(Node, left), &node.left, sizeof(node.left));
+        std::memcpy(bytes + offsetof(Node, center), &node.center, sizeof(node.center));
+        std::memcpy(bytes + offsetof(Node, right), &node.right, sizeof(node.right));
+    }
+
+    /**
+     * Checks that children come after their parents, as in breadth-first order, and are in the array - so
+     * every lookup stays in the array and ends.
+     */
+    static bool are_valid_nodes(const Node* nodes, uint64_t cnt_nodes) {
+        for (uint64_t i = 0; i < cnt_nodes; i++)
+            for (uint32_t child : {nodes[i].left, nodes[i].center, nodes[i].right})
+                if (child != kNoChild && (child <= i || child >= cnt_nodes))
+                    return false;
+        return true;
+    }
+
+    static bool is_end_of_string(C c) {
+        return c == '\0';
+    }
+
+    size_t best_prefix_length(const C* str) const {
+        size_t length = 0;
+        for (uint32_t i = 0; cnt_nodes > 0 && !is_end_of_string(str[length]);) {
+            const Node& node = nodes[i];
+            if (str[length] == node.data) {
+                length++;
+                i = node.center;
+            } else {
+                i = str[length] < node.data ? node.left : node.right;
+            }
+            if (i == kNoChild)
+                break;
+        }
+        return length;
+    }
+
+public:
+    /**
+     * Empty tree.
+     */
+    FrozenTST() = default;
+
+    /**
+     * Freezes tree, which is left unchanged.
+     * @throw std::length_error if tree has 2^32 nodes or more
+     */
+    template<typename Nodes>
+    explicit FrozenTST(const TST<C, Nodes>& tree) {
+        if (tree.empty())
+            return;
+        // Nodes are numbered in the order they are visited, so the queue is the array of nodes in the making.
+        std::vector<TST<C, Nodes>> queue = {tree};
+        owned.push_back({tree.value(), tree.word(), kNoChild, kNoChild, kNoChild});
+        auto add = [&](const TST<C, Nodes>& child) {
+            if (child.empty())
+                return kNoChild;
+            if (owned.size() == UINT32_MAX)
+                throw std::length_error("length_error: FrozenTST()");
+            queue.push_back(child);
+            owned.push_back({child.value(), child.word(), kNoChild, kNoChild, kNoChild});
+            return uint32_t(owned.size() - 1);
+        };
+        for (size_t i = 0; i < queue.size(); i++) {
+            // Copies made by add may reallocate queue.
+            TST<C, Nodes> node = std::move(queue[i]);
+            uint32_t left = add(node.left());
+            uint32_t center = add(node.center());
+            uint32_t right = add(node.right());
+            owned[i].left = left;
+            owned[i].center = center;
+            owned[i].right = right;
+        }
+        nodes = owned.data();
+        cnt_nodes = owned.size();
+    }
+
+    /**
+     * Maps a tree saved by save. Opening reads every node once to check that the file is a tree.
+     * The file must not change while it is mapped.
+     * @throw std::runtime_error if the file can't be read or isn't a frozen tree of C
+     */
+    explicit FrozenTST(const std::string& path) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            throw std::runtime_error("runtime_error: FrozenTST()");
+        struct stat status{};
+        if (fstat(fd, &status) != 0 || uint64_t(status.st_size) < sizeof(Header)) {
+            ::close(fd);
+            throw std::runtime_error("runtime_error: FrozenTST()");
+        }
+        void* data = mmap(nullptr, status.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (data == MAP_FAILED)
+            throw std::runtime_error("runtime_error: FrozenTST()");
+        Mapping new_mapping(data, status.st_size);
+
+        Header header;
+        std::memcpy(&header, new_mapping.bytes(), sizeof(header));
+        if (std::memcmp(header.magic, Header::kMagic, sizeof(header.magic)) != 0
+            || header.format_version != Header::kFormatVersion || header.char_size != sizeof(C)
+            || header.node_size != sizeof(Node)
+            || header.file_size != uint64_t(status.st_size) || header.cnt_nodes >= UINT32_MAX
+            || header.nodes % Header::kAlignment != 0 || header.nodes > header.file_size
+            || header.cnt_nodes * sizeof(Node) > header.file_size - header.nodes)
+            throw std::runtime_error("runtime_error: FrozenTST()");
+        const Node* new_nodes = reinterpret_cast<const Node*>(new_mapping.bytes() + header.nodes);
+        if (!are_valid_nodes(new_nodes, header.cnt_nodes))
+            throw std::runtime_error("runtime_error: FrozenTST()");
+
+        mapping = std::move(new_mapping);
+        nodes = new_nodes;
+        cnt_nodes = header.cnt_nodes;
+    }
+
+    FrozenTST(FrozenTST&& other) noexcept
+    : owned(std::move(other.owned))
+    , mapping(std::move(other.mapping))
+    , nodes(std::exchange(other.nodes, nullptr))
+    , cnt_nodes(std::exchange(other.cnt_nodes, 0))
+    {}
+
+    FrozenTST& operator=(FrozenTST&& other) noexcept {
+        owned = std::move(other.owned);
+        mapping = std::move(other.mapping);
+        nodes = std::exchange(other.nodes, nullptr);
+        cnt_nodes = std::exchange(other.cnt_nodes, 0);
+        return *this;
+    }
+
+    /**
+     * Writes the tree to file path, replacing it only once the whole tree is written. Padding inside nodes
+     * is written as zeros, so equal trees give equal files.
+     * @throw std::runtime_error if writing fails
+     */
+    void save(const std::string& path) const {
+        Header header{};
+        std::memcpy(header.magic, Header::kMagic, sizeof(header.magic));
+        header.format_version = Header::kFormatVersion;
+        header.char_size = sizeof(C);
+        header.node_size = sizeof(Node);
+        header.cnt_nodes = cnt_nodes;
+        header.nodes = (sizeof(Header) + Header::kAlignment - 1) / Header::kAlignment * Header::kAlignment;
+        header.file_size = header.nodes + cnt_nodes * sizeof(Node);
+
+        std::string tmp_path = path + ".tmp";
+        std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+        static const char zeros[Header::kAlignment] = {};
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(zeros, header.nodes - sizeof(header));
+        std::vector<char> chunk;
+        for (uint64_t first = 0; first < cnt_nodes; first += kNodesPerChunk) {
+            uint64_t cnt_chunk = std::min(kNodesPerChunk, cnt_nodes - first);
+            chunk.assign(cnt_chunk * sizeof(Node), 0);
+            for (uint64_t i = 0; i < cnt_chunk; i++)
+                copy_fields(chunk.data() + i * sizeof(Node), nodes[first + i]);
+            out.write(chunk.data(), chunk.size());
+        }
+        out.close();
+
+        if (!out || std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+            std::remove(tmp_path.c_str());
+            throw std::runtime_error("runtime_error: save()");
+        }
+    }
+
+    /**
+     * @return True if the tree has no nodes, false otherwise
+     */
+    bool empty() const {
+        return cnt_nodes == 0;
+    }
+
+    /**
+     * Checks whether given string is in the tree
+     * @param str - sought string
+     * @return True if word is in the tree, false otherwise
+     */
+    bool exist(const C* str) const {
+        if (cnt_nodes == 0 || is_end_of_string(str[0]))
+            return false;
+        for (uint32_t i = 0;;) {
+            const Node& node = nodes[i];
+            if (str[0] == node.data) {
+                if (is_end_of_string(str[1]))
+                    return node.flags & Node::kEndOfWord;
+                i = node.center;
+                str++;
+            } else {
+                i = str[0] < node.data ? node.left : node.right;
+            }
+            if (i == kNoChild)
+                return false;
+        }
+    }
+
+    /**
+     * Checks whether given string is in the tree
+     * @param str - sought string
+     * @return True if word is in the tree, false otherwise
+     */
+    bool exist(const std::basic_string<C>& str) const {
+        return exist(str.c_str());
+    }
+
+    /**
+     * Searches for the longest common prefix of word str and words in the tree, like TST::prefix.
+     */
+    std::basic_string<C> prefix(const C* str) const {
+        return std::basic_string<C>(str, best_prefix_length(str));
+    }
+
+    /**
+     * Searches for the longest common prefix of word str and words in the tree, like TST::prefix.
+     */
+    std::basic_string<C> prefix(const std::basic_string<C>& str) const {
+        return str.substr(0, best_prefix_length(str.c_str()));
+    }
+
+    /**
+     * @return Number of nodes in the tree
+     */
+    size_t size() const {
+        return cnt_nodes;
+    }
+};
+
+#endif // FROZEN_TST_H
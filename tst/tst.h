@@ -2,60 +2,508 @@
 #define TST_H
 
 #include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <iterator>
+#include <atomic>
+#include <thread>
+#include <exception>
+#include <queue>
+#include <cstdint>
 
 namespace Detail {
     constexpr char kEmptyData = '\0';
 
     template<typename Iter, typename Acc, typename Functor>
     Acc fold(Iter first, Iter last, Acc acc, Functor functor) {
-        return first == last ? acc : fold(std::next(first), last, functor(acc, *first), functor);
+        for (; first != last; ++first)
+            acc = functor(std::move(acc), *first);
+        return acc;
     }
 }
 
-template<typename C = char>
+/**
+ * Node storage of TST: every node is a separate std::make_shared allocation with an atomic reference count,
+ * so trees can be shared between threads. The default.
+ */
+struct SharedNodes {
+    static constexpr bool kThreadSafe = true;
+
+    template<typename Node>
+    using Link = std::shared_ptr<const Node>;
+
+    /**
+     * Creates a node. family - a link into the tree the node will join - only matters to PooledNodes.
+     */
+    template<typename Node, typename... Args>
+    static Link<Node> make(const Link<Node>&, Args&&... args) {
+        return std::make_shared<const Node>(std::forward<Args>(args)...);
+    }
+
+    /**
+     * Called by the destructor of a node. Releasing a long chain recursively would take a stack frame per node,
+     * so children owned only by the dying node are handed over to the outermost such destructor on this thread,
+     * which releases them one by one.
+     */
+    template<typename Node>
+    static void release_children(Link<Node>& left, Link<Node>& center, Link<Node>& right) noexcept {
+        thread_local std::vector<Link<Node>>* pending = nullptr;
+        std::vector<Link<Node>> queue;
+        std::vector<Link<Node>>& children = pending ? *pending : queue;
+        for (Link<Node>* child : {&left, &center, &right}) {
+            if (child->use_count() == 1) {
+                try {
+                    children.push_back(std::move(*child));
+                } catch (...) {
+                    // Without memory the child is simply released recursively.
+                }
+            }
+        }
+        if (pending)
+            return;
+
+        pending = &queue;
+        while (!queue.empty()) {
+            Link<Node> node = std::move(queue.back());
+            queue.pop_back();
+        }
+        pending = nullptr;
+    }
+};
+
+/**
+ * Node storage of TST for single-threaded use: nodes live in pools, refer to each other by pointers to their
+ * slots and count references with plain integers. Copying a tree or a child costs one increment without
+ * atomic operations, and nodes don't need separate allocations.
+ * Every tree built from scratch gets its own pool, shared by its family: its copies, its subtrees and all
+ * versions made from them. A family must not be used by two threads at once, but separate families - even
+ * of the same C - are independent. A pool is freed together with the last node of its family.
+ */
+struct PooledNodes {
+    static constexpr bool kThreadSafe = false;
+
+    template<typename Node>
+    struct Slot {
+        std::optional<Node> node;
+        uint32_t cnt_references = 0;
+        Slot* next = nullptr; // Next free slot, or next slot to release.
+    };
+
+    /**
+     * Pages of slots - nodes don't move, so pointers to them stay valid while the pool grows. Pages are
+     * aligned to their size and begin with their pool, so the pool of a slot is found from its address.
+     * The list of slots to free is threaded through the slots themselves, so releasing a long chain needs
+     * neither recursion nor memory.
+     */
+    template<typename Node>
+    class Pool {
+        static constexpr size_t kPageSize = 4096;
+        static constexpr size_t kSlotsPerPage = (kPageSize - sizeof(Pool*)) / sizeof(Slot<Node>);
+        static_assert(kSlotsPerPage > 0, "PooledNodes: node larger than a page");
+
+        struct alignas(kPageSize) Page {
+            Pool* pool;
+            Slot<Node> slots[kSlotsPerPage];
+        };
+        static_assert(sizeof(Page) == kPageSize, "PooledNodes: slots overflow a page");
+
+        std::vector<std::unique_ptr<Page>> pages;
+        Slot<Node>* first_free = nullptr;
+        Slot<Node>* first_released = nullptr;
+        size_t cnt_nodes = 0;
+        bool releasing = false;
+
+    public:
+        static Pool& of(Slot<Node>* slot) noexcept {
+            return *reinterpret_cast<Page*>(reinterpret_cast<uintptr_t>(slot) & ~uintptr_t(kPageSize - 1))->pool;
+        }
+
+        template<typename... Args>
+        Slot<Node>* allocate(Args&&... args) {
+            if (!first_free) {
+                pages.push_back(std::make_unique<Page>());
+                Page& page = *pages.back();
+                page.pool = this;
+                for (size_t i = kSlotsPerPage; i-- > 0;) {
+                    page.slots[i].next = first_free;
+                    first_free = &page.slots[i];
+                }
+            }
+            Slot<Node>* slot = first_free;
+            slot->node.emplace(std::forward<Args>(args)...);
+            first_free = slot->next;
+            slot->cnt_references = 1;
+            cnt_nodes++;
+            return slot;
+        }
+
+        /**
+         * Destroys the node of a slot no longer referenced, and the pool itself with its last node.
+         */
+        void release(Slot<Node>* slot) noexcept {
+            slot->next = first_released;
+            first_released = slot;
+            if (releasing)
+                return;
+
+            // Destroying a node releases its children, which only join the list.
+            releasing = true;
+            while (first_released) {
+                Slot<Node>* released = first_released;
+                first_released = released->next;
+                released->node.reset();
+                released->next = first_free;
+                first_free = released;
+                cnt_nodes--;
+            }
+            releasing = false;
+            if (cnt_nodes == 0)
+                delete this;
+        }
+    };
+
+    template<typename Node>
+    class Link {
+        Slot<Node>* slot = nullptr;
+
+        explicit Link(Slot<Node>* slot) noexcept : slot(slot) {}
+
+        friend struct PooledNodes;
+
+    public:
+        Link() noexcept = default;
+
+        Link(const Link& other) noexcept : slot(other.slot) {
+            if (slot)
+                slot->cnt_references++;
+        }
+
+        Link(Link&& other) noexcept : slot(std::exchange(other.slot, nullptr)) {}
+
+        Link& operator=(Link other) noexcept {
+            std::swap(slot, other.slot);
+            return *this;
+        }
+
+        ~Link() {
+            if (slot && --slot->cnt_references == 0)
+                Pool<Node>::of(slot).release(slot);
+        }
+
+        const Node* get() const noexcept {
+            return slot ? &*slot->node : nullptr;
+        }
+
+        const Node* operator->() const noexcept {
+            return get();
+        }
+
+        const Node& operator*() const noexcept {
+            return *get();
+        }
+
+        explicit operator bool() const noexcept {
+            return slot != nullptr;
+        }
+
+        long use_count() const noexcept {
+            return slot ? slot->cnt_references : 0;
+        }
+    };
+
+    /**
+     * Creates a node in the pool of family, or in a new pool if family is missing.
+     */
+    template<typename Node, typename... Args>
+    static Link<Node> make(const Link<Node>& family, Args&&... args) {
+        if (family)
+            return Link<Node>(Pool<Node>::of(family.slot).allocate(std::forward<Args>(args)...));
+        auto pool = std::make_unique<Pool<Node>>();
+        Link<Node> node(pool->allocate(std::forward<Args>(args)...));
+        pool.release();
+        return node;
+    }
+
+    template<typename Node>
+    static void release_children(Link<Node>&, Link<Node>&, Link<Node>&) noexcept {}
+};
+
+/**
+ * Persistent ternary search tree. A tree is a link to its immutable root node, so copies and versions made
+ * by operator+ share all unchanged nodes. Nodes determines how nodes are stored: SharedNodes (default)
+ * or PooledNodes.
+ */
+template<typename C = char, typename Nodes = SharedNodes>
 class TST {
-    const std::shared_ptr<const TST> left_node;
-    const std::shared_ptr<const TST> center_node;
-    const std::shared_ptr<const TST> right_node;
-    const C data = '\0';
-    const bool end_of_word = false;
+public:
+    /**
+     * Weight of a word used by top_k, 0 for words added without one.
+     */
+    using Weight = uint32_t;
+
+private:
+    struct Node;
+    using Link = typename Nodes::template Link<Node>;
+
+    struct Node {
+        Link left_node;
+        Link center_node;
+        Link right_node;
+        C data;
+        bool end_of_word;
+        Weight weight; // Of the word ending here.
+        Weight max_weight; // Greatest weight in the subtree, so top_k can skip whole subtrees.
+
+        Node(Link left, Link center, Link right, C data, bool end_of_word, Weight weight)
+        : left_node(std::move(left))
+        , center_node(std::move(center))
+        , right_node(std::move(right))
+        , data(data)
+        , end_of_word(end_of_word)
+        , weight(weight)
+        , max_weight(std::max({weight, max_weight_of(left_node), max_weight_of(center_node),
+                               max_weight_of(right_node)}))
+        {}
+
+        static Weight max_weight_of(const Link& node) {
+            return node ? node->max_weight : 0;
+        }
+
+        Node(const Node&) = delete;
+        Node& operator=(const Node&) = delete;
+
+        ~Node() {
+            Nodes::release_children(left_node, center_node, right_node);
+        }
+
+        bool go_left(C c) const {
+            return c < data;
+        }
+
+        bool go_right(C c) const {
+            return c > data;
+        }
+
+        bool go_center(C c) const {
+            return c == data;
+        }
+    };
+
+    Link root; // Missing for an empty tree.
+
+    explicit TST(Link root)
+    : root(std::move(root))
+    {}
 
     static bool is_end_of_string(C c) {
         return c == '\0';
     }
 
-    static const auto& empty_node() {
-        static auto res = std::make_shared<const TST<C>>();
-        return res;
+    /**
+     * Creates a node joining the tree of family, or starting a new tree if family is missing.
+     */
+    template<typename... Args>
+    static Link make_node(const Link& family, Args&&... args) {
+        return Nodes::template make<Node>(family, std::forward<Args>(args)...);
     }
 
-    bool go_left(C c) const {
-        return c < data;
+    /**
+     * Builds the center chain of str - one node per character, the last one ending a word of the given
+     * weight - starting from the last character, so long keys don't need a stack frame per character.
+     * @param family - tree the chain will join, missing for a new tree
+     * @return First node of the chain, missing for an empty string
+     */
+    static Link chain(const C* str, Weight weight = 0, const Link& family = Link()) {
+        Link node;
+        for (size_t i = std::char_traits<C>::length(str); i-- > 0;) {
+            bool end_of_word = is_end_of_string(str[i + 1]);
+            node = make_node(node ? node : family, Link(), std::move(node), Link(), str[i], end_of_word,
+                             end_of_word ? weight : 0);
+        }
+        return node;
     }
 
-    bool go_right(C c) const {
-        return c > data;
+    /**
+     * @return Node of the last character of prefix, nullptr if prefix is empty or not in the tree
+     */
+    const Node* find(std::basic_string_view<C> prefix) const {
+        const Node* node = prefix.empty() ? nullptr : root.get();
+        for (size_t i = 0; node;) {
+            if (node->go_center(prefix[i])) {
+                if (++i == prefix.size())
+                    return node;
+                node = node->center_node.get();
+            } else {
+                node = node->go_left(prefix[i]) ? node->left_node.get() : node->right_node.get();
+            }
+        }
+        return nullptr;
     }
 
-    bool go_center(C c) const {
-        return c == data;
-    }
+    /**
+     * Adds str, keeping the weight it already has unless weight is given.
+     */
+    TST insert(const C* str, std::optional<Weight> weight) const {
+        if (empty())
+            return TST(chain(str, weight.value_or(0)));
+        if (is_end_of_string(str[0]))
+            return *this;
 
-    TST(std::shared_ptr<const TST> left, std::shared_ptr<const TST> center, std::shared_ptr<const TST> right, C data, bool end_of_word)
-    : left_node(std::move(left))
-    , center_node(std::move(center))
-    , right_node(std::move(right))
-    , data(data)
-    , end_of_word(end_of_word)
-    {}
+        // Walk down to the insertion point remembering the path. Nodes on the path are copied bottom-up,
+        // everything else is shared with this tree.
+        struct Step {
+            const Node* node;
+            const Link* next;
+            bool end_of_word;
+            Weight weight;
+        };
+        std::vector<Step> path;
+        const Link* next = &root;
+        for (const Node* node = root.get(); node && !is_end_of_string(str[0]); node = next->get()) {
+            bool end_of_word = node->end_of_word;
+            Weight node_weight = node->weight;
+            if (node->go_center(str[0])) {
+                next = &node->center_node;
+                if (is_end_of_string(str[1])) {
+                    end_of_word = true;
+                    node_weight = weight.value_or(node_weight);
+                }
+                str++;
+            } else {
+                next = node->go_left(str[0]) ? &node->left_node : &node->right_node;
+            }
+            path.push_back({node, next, end_of_word, node_weight});
+        }
+
+        Link subtree = is_end_of_string(str[0]) ? *next : chain(str, weight.value_or(0), root);
+        auto child = [&subtree](const Step& step, const Link& node) -> const Link& {
+            return step.next == &node ? subtree : node;
+        };
+        for (size_t i = path.size(); i-- > 0;) {
+            const Step& step = path[i];
+            subtree = make_node(root, child(step, step.node->left_node), child(step, step.node->center_node),
+                                child(step, step.node->right_node), step.node->data, step.end_of_word, step.weight);
+        }
+        return TST(std::move(subtree));
+    }
 
     size_t best_prefix_length(const C* str) const {
-        return is_end_of_string(str[0]) || this->empty() ? 0
-        : (go_center(str[0]) ? (1 + center_node->best_prefix_length(str + 1))
-        : (go_left(str[0]) ? left_node->best_prefix_length(str)
-        : right_node->best_prefix_length(str)));
+        size_t length = 0;
+        for (const Node* node = root.get(); !is_end_of_string(str[length]) && node;) {
+            if (node->go_center(str[length])) {
+                node = node->center_node.get();
+                length++;
+            } else {
+                node = node->go_left(str[length]) ? node->left_node.get() : node->right_node.get();
+            }
+        }
+        return length;
     }
 
+    using Keys = std::vector<std::basic_string_view<C>>;
+
+    static constexpr size_t kNoNode = SIZE_MAX;
+
+    /**
+     * Keys [first, last) sharing the first depth characters, all longer than that - the part of one level
+     * of the tree built by from_sorted.
+     */
+    struct KeyRange {
+        size_t first;
+        size_t last;
+        size_t depth;
+    };
+
+    /**
+     * Node planned by from_sorted. Children are positions in the plan (or kNoNode); a node with subtree
+     * set stands for a range built separately.
+     */
+    struct PlannedNode {
+        C data;
+        bool end_of_word;
+        size_t left;
+        size_t center;
+        size_t right;
+        size_t subtree;
+    };
+
+    /**
+     * Plans the tree of keys in range: the median key's character at the current depth becomes a node,
+     * keys with smaller and greater characters go to its left and right, and the rest - one level deeper - to
+     * its center. Ranges of at most max_deferred keys are not expanded but appended to deferred. Every node
+     * is planned after its parent.
+     */
+    static std::vector<PlannedNode> plan(const Keys& keys, KeyRange range, size_t max_deferred,
+                                         std::vector<KeyRange>& deferred) {
+        std::vector<PlannedNode> planned;
+        std::vector<std::pair<KeyRange, size_t>> pending;
+        auto add = [&](KeyRange added) {
+            if (added.first == added.last)
+                return kNoNode;
+            planned.push_back({C(), false, kNoNode, kNoNode, kNoNode, kNoNode});
+            if (added.last - added.first <= max_deferred) {
+                planned.back().subtree = deferred.size();
+                deferred.push_back(added);
+            } else {
+                pending.push_back({added, planned.size() - 1});
+            }
+            return planned.size() - 1;
+        };
+
+        add(range);
+        while (!pending.empty()) {
+            auto [current, node] = pending.back();
+            pending.pop_back();
+            size_t depth = current.depth;
+            auto first = keys.begin() + current.first, last = keys.begin() + current.last;
+            auto middle = first + (last - first) / 2;
+            C c = (*middle)[depth];
+            auto run_first = std::partition_point(first, middle, [&](const auto& key) { return key[depth] < c; });
+            auto run_last = std::partition_point(middle, last, [&](const auto& key) { return !(c < key[depth]); });
+            // Keys ending here are the smallest ones in the run.
+            auto longer = std::partition_point(run_first, run_last, [&](const auto& key) {
+                return key.size() == depth + 1;
+            });
+
+            size_t left = add({current.first, size_t(run_first - keys.begin()), depth});
+            size_t center = add({size_t(longer - keys.begin()), size_t(run_last - keys.begin()), depth + 1});
+            size_t right = add({size_t(run_last - keys.begin()), current.last, depth});
+            planned[node] = {c, longer != run_first, left, center, right, kNoNode};
+        }
+        return planned;
+    }
+
+    /**
+     * Creates planned nodes bottom-up - exactly one allocation per node.
+     * @return Root of the planned tree
+     */
+    static Link build(const std::vector<PlannedNode>& planned, std::vector<Link>& subtrees) {
+        std::vector<Link> built(planned.size());
+        auto take = [&built](size_t child) {
+            return child == kNoNode ? Link() : std::move(built[child]);
+        };
+        Link family; // First node built, which all the others join.
+        for (size_t i = planned.size(); i-- > 0;) {
+            const PlannedNode& node = planned[i];
+            built[i] = node.subtree != kNoNode ? std::move(subtrees[node.subtree])
+                     : make_node(family, take(node.left), take(node.center), take(node.right), node.data,
+                                 node.end_of_word, 0);
+            if (!family)
+                family = built[i];
+        }
+        return built.empty() ? Link() : std::move(built[0]);
+    }
+
+    static Link build(const Keys& keys, KeyRange range) {
+        std::vector<KeyRange> deferred;
+        std::vector<Link> subtrees;
+        return build(plan(keys, range, 0, deferred), subtrees);
+    }
 
 public:
     TST() = default;
@@ -65,12 +513,7 @@ public:
     {}
 
     TST(const C* str)
-    : left_node(empty_node())
-    , center_node(is_end_of_string(str[0]) || is_end_of_string(str[1]) ? empty_node()
-                                                                       : std::make_shared<TST<C>>(str + 1))
-    , right_node(empty_node())
-    , data(str[0])
-    , end_of_word(is_end_of_string(str[0]) ? false : is_end_of_string(str[1])) // In case of giving empty string to the constructor
+    : root(chain(str))
     {}
 
     TST operator+(const std::basic_string<C>& str) const {
@@ -78,54 +521,129 @@ public:
     }
 
     TST operator+(const C* str) const {
-        return empty() ? TST(str)
-        : is_end_of_string(str[0]) ? *this
-        : go_left(str[0]) ? TST(std::make_shared<TST>(left() + str), center_node, right_node, data, end_of_word)
-        : go_right(str[0]) ? TST(left_node, center_node, std::make_shared<TST>(right() + str), data, end_of_word)
-        : TST(left_node, std::make_shared<TST>(center() + (str + 1)), right_node, data, is_end_of_string(str[1]));
+        return insert(str, std::nullopt);
+    }
+
+    /**
+     * @return Tree with word str of the given weight. If str is already in the tree, only its weight changes.
+     */
+    TST add(const std::basic_string<C>& str, Weight weight) const {
+        return add(&*(str.begin()), weight);
+    }
+
+    /**
+     * @return Tree with word str of the given weight. If str is already in the tree, only its weight changes.
+     */
+    TST add(const C* str, Weight weight) const {
+        return insert(str, weight);
+    }
+
+    /**
+     * Builds a balanced tree of the given words at once, allocating each node exactly once. At every level
+     * the median word's character is the root, so sorted input doesn't produce a list-shaped tree.
+     * Empty words are skipped, repeated words are allowed. All words get weight 0.
+     * @param first, last - words (strings or C strings) sorted lexicographically by C's operator<
+     * @param cnt_threads - number of threads building independent subtrees, ignored unless Nodes is thread safe
+     * @throw std::invalid_argument if words are not sorted
+     */
+    template<typename Iter>
+    static TST from_sorted(Iter first, Iter last, unsigned cnt_threads = 1) {
+        Keys keys(first, last);
+        auto less = [](const auto& a, const auto& b) {
+            return std::lexicographical_compare(a.begin(), a.end(), b.begin(), b.end());
+        };
+        if (!std::is_sorted(keys.begin(), keys.end(), less))
+            throw std::invalid_argument("invalid_argument: from_sorted()");
+        keys.erase(keys.begin(), std::find_if(keys.begin(), keys.end(), [](const auto& key) { return !key.empty(); }));
+
+        KeyRange all{0, keys.size(), 0};
+        if (cnt_threads <= 1 || !Nodes::kThreadSafe)
+            return TST(build(keys, all));
+
+        // The top of the tree is planned here, ranges small enough are built by the threads.
+        std::vector<KeyRange> deferred;
+        std::vector<PlannedNode> top = plan(keys, all, keys.size() / (8 * cnt_threads) + 1, deferred);
+        std::vector<Link> subtrees(deferred.size());
+        std::atomic<size_t> next{0};
+        std::vector<std::exception_ptr> errors(cnt_threads);
+        auto worker = [&](unsigned thread_id) {
+            try {
+                for (size_t i = next++; i < deferred.size(); i = next++)
+                    subtrees[i] = build(keys, deferred[i]);
+            } catch (...) {
+                errors[thread_id] = std::current_exception();
+                next = deferred.size();
+            }
+        };
+        std::vector<std::thread> threads;
+        try {
+            for (unsigned thread_id = 1; thread_id < cnt_threads; thread_id++)
+                threads.emplace_back(worker, thread_id);
+        } catch (...) {
+            // Threads already started must be joined before they are destroyed.
+            next = deferred.size();
+            for (std::thread& thread : threads)
+                thread.join();
+            throw;
+        }
+        worker(0);
+        for (std::thread& thread : threads)
+            thread.join();
+        for (const std::exception_ptr& error : errors)
+            if (error)
+                std::rethrow_exception(error);
+        return TST(build(top, subtrees));
+    }
+
+    /**
+     * Builds a balanced tree of the given words at once, see from_sorted(first, last, cnt_threads).
+     */
+    template<typename Range>
+    static TST from_sorted(const Range& words, unsigned cnt_threads = 1) {
+        return from_sorted(std::begin(words), std::end(words), cnt_threads);
     }
 
     /**
      * @return Data stored in the node
      */
     C value() const {
-        return this->empty() ? throw std::logic_error("logic_error: value()") : this->data;
+        return this->empty() ? throw std::logic_error("logic_error: value()") : root->data;
     }
 
     /**
      * @return True if the node is the end of some word, false otherwise.
      */
     bool word() const {
-        return this->empty() ? throw std::logic_error("logic_error: word()") : this->end_of_word;
+        return this->empty() ? throw std::logic_error("logic_error: word()") : root->end_of_word;
     }
 
     /**
      * @return Returns left child of the node
      */
     TST left() const {
-        return this->empty() ? throw std::logic_error("logic_error: left()") : *(this->left_node);
+        return this->empty() ? throw std::logic_error("logic_error: left()") : TST(root->left_node);
     }
 
     /**
      * @return Returns center child of the node
      */
     TST center() const {
-        return this->empty() ? throw std::logic_error("logic_error: center()") : *(this->center_node);
+        return this->empty() ? throw std::logic_error("logic_error: center()") : TST(root->center_node);
     }
 
     /**
      * @return Returns right child of the node
      */
     TST right() const {
-        return this->empty() ? throw std::logic_error("logic_error: right()") : *(this->right_node);
+        return this->empty() ? throw std::logic_error("logic_error: right()") : TST(root->right_node);
     }
 
    /**
-    * Node is empty iff it's data is equal Detail::kEmptyData
+    * Node is empty iff there is no node, its data would be Detail::kEmptyData
     * @return True if the node is empty, false otherwise
     */
     bool empty() const {
-        return data == Detail::kEmptyData;
+        return !root || root->data == Detail::kEmptyData;
     }
 
     /**
@@ -134,11 +652,17 @@ public:
      * @return True if word is in the tree, false otherwise
      */
     bool exist(const C* str) const {
-        return is_end_of_string(str[0]) || this->empty() ? false
-        : go_center(str[0]) && is_end_of_string(str[1]) ? end_of_word
-        : go_left(str[0]) ? left_node->exist(str)
-        : go_right(str[0]) ? right_node->exist(str)
-        : center_node->exist(str + 1);
+        for (const Node* node = root.get(); !is_end_of_string(str[0]) && node;) {
+            if (node->go_center(str[0])) {
+                if (is_end_of_string(str[1]))
+                    return node->end_of_word;
+                node = node->center_node.get();
+                str++;
+            } else {
+                node = node->go_left(str[0]) ? node->left_node.get() : node->right_node.get();
+            }
+        }
+        return false;
     }
 
     /**
@@ -166,10 +690,27 @@ public:
         return str.substr(0, this->best_prefix_length(&*(str.begin())));
     }
 
+    /**
+     * Folds values of all nodes in the order functor(left().fold(center().fold(right().fold(acc)))), value()):
+     * right subtree, center subtree, left subtree and the node itself, with an explicit stack.
+     */
     template<typename Acc, typename Functor>
     Acc fold(Acc acc, Functor functor) const {
-        return empty() ? acc :
-               functor(left().fold(center().fold(right().fold(acc, functor), functor), functor), value());
+        // Pre-order with children left, center, right is exactly the reverse of the fold order.
+        std::vector<const Node*> order, stack = {root.get()};
+        while (!stack.empty()) {
+            const Node* node = stack.back();
+            stack.pop_back();
+            if (!node)
+                continue;
+            order.push_back(node);
+            stack.push_back(node->right_node.get());
+            stack.push_back(node->center_node.get());
+            stack.push_back(node->left_node.get());
+        }
+        for (auto node = order.rbegin(); node != order.rend(); ++node)
+            acc = functor(std::move(acc), (*node)->data);
+        return acc;
     }
 
     /**
@@ -180,6 +721,213 @@ public:
             return acc + 1;
         });
     }
+
+    /**
+     * Input iterator over words of a subtree in lexicographic order. Words are built one at a time in a single
+     * buffer: a word is a view into it, valid until the iterator is incremented. The iterator shares the nodes
+     * it walks, so it stays valid after the tree is gone.
+     */
+    class WordIterator {
+        struct Frame {
+            const Node* node;
+            int stage; // 0 - left subtree next, 1 - the node itself, 2 - center subtree, 3 - right subtree.
+        };
+
+        Link subtree;
+        std::basic_string<C> word;
+        std::vector<Frame> stack;
+        bool ended = true;
+
+        /**
+         * In-order walk: left subtree, the word ending at the node, center subtree (with the node's character
+         * appended to the word) and right subtree. Stops at the next word.
+         */
+        void advance() {
+            while (!stack.empty()) {
+                Frame& frame = stack.back();
+                const Node* node = frame.node;
+                switch (frame.stage++) {
+                    case 0:
+                        if (node->left_node)
+                            stack.push_back({node->left_node.get(), 0});
+                        break;
+                    case 1:
+                        word.push_back(node->data);
+                        if (node->end_of_word)
+                            return;
+                        break;
+                    case 2:
+                        if (node->center_node)
+                            stack.push_back({node->center_node.get(), 0});
+                        break;
+                    default:
+                        // The right subtree replaces the node, so the stack grows only with center chains.
+                        word.pop_back();
+                        stack.pop_back();
+                        if (node->right_node)
+                            stack.push_back({node->right_node.get(), 0});
+                }
+            }
+            ended = true;
+        }
+
+        friend class TST;
+
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = std::basic_string<C>;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const std::basic_string<C>*;
+        using reference = std::basic_string_view<C>;
+
+        /**
+         * Past-the-end iterator.
+         */
+        WordIterator() = default;
+
+        std::basic_string_view<C> operator*() const {
+            return word;
+        }
+
+        WordIterator& operator++() {
+            advance();
+            return *this;
+        }
+
+        void operator++(int) {
+            advance();
+        }
+
+        /**
+         * Iterators over the same words are equal iff both are past the end or stand at the same word.
+         */
+        bool operator==(const WordIterator& other) const {
+            return ended == other.ended && (ended || word == other.word);
+        }
+
+        bool operator!=(const WordIterator& other) const {
+            return !(*this == other);
+        }
+    };
+
+    /**
+     * Words starting with a given prefix, see words(prefix).
+     */
+    class WordRange {
+        WordIterator first;
+
+        friend class TST;
+
+    public:
+        WordIterator begin() const {
+            return first;
+        }
+
+        WordIterator end() const {
+            return WordIterator();
+        }
+    };
+
+    /**
+     * Lazily enumerates words starting with prefix (including prefix itself) in lexicographic order.
+     * For example if tst contains "category", "cat" and "theory" then tst.words("ca") yields "cat" and "category"
+     */
+    WordRange words(std::basic_string_view<C> prefix = {}) const {
+        WordRange range;
+        WordIterator& it = range.first;
+        const Node* node = find(prefix);
+        if (!prefix.empty() && !node)
+            return range;
+
+        it.subtree = root;
+        it.word = prefix;
+        const Node* first = node ? node->center_node.get() : root.get();
+        if (first)
+            it.stack.push_back({first, 0});
+        it.ended = false;
+        if (!node || !node->end_of_word)
+            it.advance();
+        return range;
+    }
+
+    /**
+     * @return At most limit words starting with prefix (including prefix itself) in lexicographic order
+     */
+    std::vector<std::basic_string<C>> words_with_prefix(std::basic_string_view<C> prefix,
+                                                        size_t limit = SIZE_MAX) const {
+        std::vector<std::basic_string<C>> result;
+        for (WordIterator it = words(prefix).begin(); it != WordIterator() && result.size() < limit; ++it)
+            result.emplace_back(*it);
+        return result;
+    }
+
+    /**
+     * Autocompletion: k words of the greatest weights starting with prefix (including prefix itself), from the
+     * heaviest; words of equal weights come in no particular order. Subtrees are searched
+     * best-first by their greatest weight, so only nodes leading to the result and their siblings are visited.
+     * @return Pairs of a word and its weight
+     */
+    std::vector<std::pair<std::basic_string<C>, Weight>> top_k(std::basic_string_view<C> prefix, size_t k) const {
+        // Words found so far share their beginnings: a path is its last character and the path before it.
+        static constexpr size_t kPrefix = SIZE_MAX;
+        std::vector<std::pair<size_t, C>> paths;
+        auto extend = [&paths](size_t path, C c) {
+            paths.push_back({path, c});
+            return paths.size() - 1;
+        };
+
+        // A candidate is either a subtree or a word ending at node. Candidates of equal weight come out last
+        // in, first out, so without weights the search goes depth-first instead of visiting the whole tree.
+        struct Candidate {
+            Weight weight;
+            size_t order;
+            const Node* node;
+            size_t path;
+            bool is_word;
+
+            bool operator<(const Candidate& other) const {
+                return weight != other.weight ? weight < other.weight : order < other.order;
+            }
+        };
+        std::priority_queue<Candidate> candidates;
+        size_t order = 0;
+        auto push = [&](const Node* node, size_t path, bool is_word) {
+            if (node)
+                candidates.push({is_word ? node->weight : node->max_weight, order++, node, path, is_word});
+        };
+
+        std::vector<std::pair<std::basic_string<C>, Weight>> result;
+        if (prefix.empty()) {
+            push(root.get(), kPrefix, false);
+        } else if (const Node* node = find(prefix)) {
+            push(node->center_node.get(), kPrefix, false);
+            if (node->end_of_word)
+                push(node, kPrefix, true);
+        }
+
+        while (!candidates.empty() && result.size() < k) {
+            Candidate candidate = candidates.top();
+            candidates.pop();
+            const Node* node = candidate.node;
+            if (candidate.is_word) {
+                std::basic_string<C> word;
+                for (size_t path = candidate.path; path != kPrefix; path = paths[path].first)
+                    word.push_back(paths[path].second);
+                word.append(prefix.rbegin(), prefix.rend());
+                std::reverse(word.begin(), word.end());
+                result.push_back({std::move(word), node->weight});
+                continue;
+            }
+
+            size_t path = extend(candidate.path, node->data);
+            push(node->right_node.get(), candidate.path, false);
+            push(node->center_node.get(), path, false);
+            if (node->end_of_word)
+                push(node, path, true);
+            push(node->left_node.get(), candidate.path, false);
+        }
+        return result;
+    }
 };
 
 #endif // TST_H
@@ -0,0 +1,218 @@
+#include "tst.h"
+#include "frozen_tst.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+// Benchmark on a large dictionary of long keys: ./tst_benchmark [number_of_keys] [key_length],
+// by default 1M keys of 64 characters. Keys share a long common prefix, like URLs.
+
+class Timer {
+public:
+  explicit Timer(std::string _name) : name(std::move(_name)), start(std::chrono::steady_clock::now()) {
+  }
+  ~Timer() {
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << name << ": " << elapsed.count() << " s" << std::endl;
+  }
+private:
+  std::string name;
+  std::chrono::steady_clock::time_point start;
+};
+
+// Prints percentiles of latencies of single queries, given in seconds.
+void print_latencies(std::string const &name, std::vector<double> latencies) {
+  std::sort(latencies.begin(), latencies.end());
+  auto percentile = [&latencies](double p) { return latencies[size_t(p * (latencies.size() - 1))] * 1e6; };
+  std::cout << name << ": p50 " << percentile(0.5) << " us, p99 " << percentile(0.99) << " us, max "
+            << percentile(1) << " us" << std::endl;
+}
+
+// Walks the whole tree through left(), center() and right(), which copy links - mostly reference counting.
+template <typename Tree>
+uint64_t traverse(Tree const &tree) {
+  uint64_t cnt_words = 0;
+  std::vector<Tree> stack = {tree};
+  while (!stack.empty()) {
+    Tree node = std::move(stack.back());
+    stack.pop_back();
+    if (node.empty())
+      continue;
+    cnt_words += node.word();
+    stack.push_back(node.left());
+    stack.push_back(node.center());
+    stack.push_back(node.right());
+  }
+  return cnt_words;
+}
+
+template <typename Tree>
+uint64_t run(std::string const &name, std::vector<std::string> const &keys, std::vector<std::string> const &sorted_keys,
+             std::vector<std::string> const &queries, size_t common_length) {
+  std::mt19937_64 rng(2020);
+  uint64_t checksum = 0;
+  std::optional<Tree> tree(std::in_place);
+  {
+    Timer timer(name + " operator+");
+    for (std::string const &key : keys)
+      tree = *tree + key;
+  }
+
+  {
+    Timer timer(name + " exist (hits)");
+    for (size_t i = 0; i < keys.size(); i++)
+      checksum += tree->exist(keys[rng() % keys.size()]);
+  }
+
+  {
+    Timer timer(name + " exist (random keys)");
+    for (std::string const &query : queries)
+      checksum += tree->exist(query);
+  }
+
+  {
+    Timer timer(name + " prefix");
+    for (std::string const &query : queries)
+      checksum += tree->prefix(query).size();
+  }
+
+  {
+    Timer timer(name + " traversal through left/center/right");
+    checksum += traverse(*tree);
+  }
+
+  {
+    Timer timer(name + " size");
+    checksum += tree->size();
+  }
+
+  {
+    std::optional<FrozenTST<>> frozen;
+    {
+      Timer timer(name + " freeze");
+      frozen.emplace(*tree);
+    }
+    {
+      Timer timer(name + " FrozenTST exist (random keys)");
+      for (std::string const &query : queries)
+        checksum += frozen->exist(query);
+    }
+    {
+      Timer timer(name + " FrozenTST prefix");
+      for (std::string const &query : queries)
+        checksum += frozen->prefix(query).size();
+    }
+    std::string const file_path = "tst_benchmark.frozen";
+    {
+      Timer timer(name + " FrozenTST::save");
+      frozen->save(file_path);
+    }
+    {
+      Timer timer(name + " FrozenTST (open)");
+      frozen.emplace(file_path);
+    }
+    {
+      Timer timer(name + " FrozenTST exist (random keys, mapped)");
+      for (std::string const &query : queries)
+        checksum += frozen->exist(query);
+    }
+    std::remove(file_path.c_str());
+  }
+
+  {
+    Timer timer(name + " destruction");
+    tree.reset();
+  }
+
+  {
+    Timer timer(name + " from_sorted (1 thread)");
+    tree.emplace(Tree::from_sorted(sorted_keys));
+  }
+  tree.reset();
+  {
+    unsigned cnt_threads = std::max(2u, std::thread::hardware_concurrency());
+    Timer timer(name + " from_sorted (" + std::to_string(cnt_threads) + " threads)");
+    tree.emplace(Tree::from_sorted(sorted_keys, cnt_threads));
+  }
+  {
+    Timer timer(name + " exist (random keys, from_sorted)");
+    for (std::string const &query : queries)
+      checksum += tree->exist(query);
+  }
+  tree.reset();
+
+  {
+    Timer timer(name + " add (with weights)");
+    tree.emplace();
+    for (std::string const &key : keys)
+      tree = tree->add(key, rng() % 1'000'000);
+  }
+  {
+    // Autocompletion of the common prefix followed by 0 to 3 letters.
+    std::vector<double> top_k_latencies, words_latencies;
+    for (size_t i = 0; i < std::min<size_t>(100'000, queries.size()); i++) {
+      std::string const prefix = queries[i].substr(0, std::min(queries[i].size(), common_length + i % 4));
+      auto start = std::chrono::steady_clock::now();
+      checksum += tree->top_k(prefix, 10).size();
+      auto middle = std::chrono::steady_clock::now();
+      checksum += tree->words_with_prefix(prefix, 10).size();
+      auto end = std::chrono::steady_clock::now();
+      top_k_latencies.push_back(std::chrono::duration<double>(middle - start).count());
+      words_latencies.push_back(std::chrono::duration<double>(end - middle).count());
+    }
+    print_latencies(name + " top_k (k = 10)", top_k_latencies);
+    print_latencies(name + " words_with_prefix (limit = 10)", words_latencies);
+  }
+  {
+    Timer timer(name + " words (all, lazily)");
+    for (std::string_view word : tree->words())
+      checksum += word.size();
+  }
+  tree.reset();
+
+  {
+    std::string long_key(10'000'000, 'a');
+    for (size_t i = 0; i < long_key.size(); i++)
+      long_key[i] += i % 26;
+    Timer timer(name + " key of 10M characters: construction, exist, destruction");
+    Tree long_tree(long_key);
+    checksum += long_tree.exist(long_key);
+  }
+  return checksum;
+}
+
+int main(int argc, char *argv[]) {
+  uint64_t const cnt_keys = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1'000'000;
+  size_t const key_length = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 64;
+  size_t const cnt_random = std::min<size_t>(8, key_length);
+  std::mt19937_64 rng(2020);
+
+  std::string const common(key_length - cnt_random, '/');
+  auto random_key = [&] {
+    std::string key = common;
+    for (size_t i = 0; i < cnt_random; i++)
+      key += char('a' + rng() % 26);
+    return key;
+  };
+  std::vector<std::string> keys(cnt_keys), queries(cnt_keys);
+  for (std::string &key : keys)
+    key = random_key();
+  for (std::string &query : queries)
+    query = random_key();
+  std::vector<std::string> sorted_keys = keys;
+  std::sort(sorted_keys.begin(), sorted_keys.end());
+
+  uint64_t checksum = run<TST<char, SharedNodes>>("SharedNodes", keys, sorted_keys, queries, common.size());
+  checksum += run<TST<char, PooledNodes>>("PooledNodes", keys, sorted_keys, queries, common.size());
+  std::cout << "checksum: " << checksum << std::endl;
+}
@@ -4,6 +4,8 @@
 #include <regex>
 #include <cmath>
 #include <climits>
+#include <utility>
+#include <stdexcept>
 
 namespace {
     using namespace std;
@@ -12,14 +14,14 @@ namespace {
     // Przy odejmowaniu w1 - w2 / w1-=w2, stan portfela w2 po operacji jest 2 razy większy niż przed.
     constexpr int64_t STARTING_NUMBER_OF_B_IN_UNITS_IN_CIRCULATION = (int64_t)(21 * 1e6 * 1e8);
     constexpr int MAX_PRECISION = 8;
-    constexpr int64_t UNITS_CONVERTER = (int64_t)1e8;
+    using FixedPoint::UNITS_CONVERTER;
     constexpr int DATE_LENGTH = 11;
     constexpr int64_t EMPTY_WALLET_VALUE = 0;
     const regex STRING_CONSTRUCTOR_REGEX(R"(^\s*([1-9]{1}\d{0,7}|0)((\.|\,)(\d{1,8}))?\s*$)");
 
     string valueToString(int64_t value) {
-        int64_t integer_part = value / UNITS_CONVERTER;
-        int64_t fractional_part = value % UNITS_CONVERTER;
+        int64_t integer_part = FixedPoint::integerPart(value);
+        int64_t fractional_part = FixedPoint::fractionalPart(value);
         string ans = to_string(integer_part);
 
         int cnt_zeros = 0;
@@ -69,8 +71,7 @@ Wallet::Wallet() : value(getFromCirculation(INITIAL_WALLET_VALUE)) {
 
 Wallet::Wallet(int n) {
     minWalletValueValidation(n);
-    multiplicationValidation(n, UNITS_CONVERTER);
-    this->value = getFromCirculation(((int64_t) n) * UNITS_CONVERTER);
+    this->value = getFromCirculation(checkedMultiply(n, UNITS_CONVERTER));
     this->addOperation();
 }
 
@@ -195,7 +196,7 @@ Wallet operator+(Wallet&& w1, Wallet& w2) {
 }
 
 Wallet& Wallet::operator-=(Wallet&& rhs) {
-    minWalletValueValidation(this->value - rhs.value);
+    minWalletValueValidation(checkedSubtract(this->value, rhs.value));
 
     this->updateValue(-addToCirculation(rhs.value));
     rhs.updateValue(getFromCirculation(0));
@@ -208,12 +209,13 @@ Wallet& Wallet::operator-=(Wallet& rhs) {
 }
 
 Wallet operator-(Wallet&& w1, Wallet&& w2) {
-    Wallet::minWalletValueValidation(w1.value - w2.value);
-    Wallet::multiplicationValidation(w2.value, 2);
+    int64_t difference = Wallet::checkedSubtract(w1.value, w2.value);
+    Wallet::minWalletValueValidation(difference);
+    Wallet::checkedMultiply(w2.value, 2);
 
     Wallet newWallet;
-    newWallet.getAndSet(w1.value - w2.value);
-    w1.getAndSet(w1.value - w2.value);
+    newWallet.getAndSet(difference);
+    w1.getAndSet(difference);
 
     return newWallet;
 }
@@ -225,22 +227,22 @@ Wallet operator-(Wallet&& w1, Wallet& w2) {
 
 Wallet& Wallet::operator*=(int64_t n) {
     naturalNumberValidation(n);
-    multiplicationValidation(this->value, n);
+    int64_t product = checkedMultiply(this->value, n);
 
     if (n == 0)
         this->returnAllB();
     else
-        this->updateValue(getFromCirculation(this->value * (n - 1)));
+        this->updateValue(getFromCirculation(product - this->value));
 
     return *this;
 }
 
 Wallet Wallet::operator*(int64_t n) const {
     naturalNumberValidation(n);
-    multiplicationValidation(this->value, n);
+    int64_t product = checkedMultiply(this->value, n);
 
     Wallet newWallet;
-    newWallet.value = getFromCirculation(this->value * n);
+    newWallet.value = getFromCirculation(product);
 
     return newWallet;
 }
@@ -322,9 +324,20 @@ int64_t Wallet::returnAllB() {
     return returned;
 }
 
-void Wallet::multiplicationValidation(int64_t a, int64_t b) {
-    if (a != 0 && b != 0 && a >= INT64_MAX / b)
+int64_t Wallet::checkedMultiply(int64_t a, int64_t b) {
+    int64_t result = 0;
+    if (FixedPoint::mulOverflow(a, b, result))
         throw noBInCirculation();
+
+    return result;
+}
+
+int64_t Wallet::checkedSubtract(int64_t a, int64_t b) {
+    int64_t result = 0;
+    if (FixedPoint::subOverflow(a, b, result))
+        throw noBInCirculation();
+
+    return result;
 }
 
 void Wallet::minWalletValueValidation(int64_t value) {
@@ -336,3 +349,36 @@ void Wallet::naturalNumberValidation(int64_t value) {
     if (value < 0)
         throw invalid_argument("Podana wartość musi być liczbą naturalną");
 }
+
+
+/*** FIXED POINT ***/
+size_t FixedPoint::scaleUnits(const int64_t *__restrict units, int64_t *__restrict result,
+                              uint8_t *__restrict overflow, size_t size, int64_t n) {
+    if (n < 0)
+        throw invalid_argument("Podana wartość musi być liczbą naturalną");
+
+    // Dla n > 0: units * n mieści się w int64_t wtw. gdy units należy do [INT64_MIN / n, INT64_MAX / n].
+    const int64_t upper_bound = n == 0 ? INT64_MAX : INT64_MAX / n;
+    const int64_t lower_bound = n == 0 ? INT64_MIN : INT64_MIN / n;
+    size_t cnt_overflows = 0;
+
+    for (size_t i = 0; i < size; i++) {
+        const int64_t u = units[i];
+        const uint8_t of = (u > upper_bound) | (u < lower_bound);
+        // Mnożenie bez znaku - nie ma UB przy przepełnieniu, a wynik i tak jest zerowany maską.
+        const int64_t product = (int64_t)((uint64_t)u * (uint64_t)n);
+        result[i] = product & ((int64_t)of - 1);
+        overflow[i] = of;
+        cnt_overflows += of;
+    }
+
+    return cnt_overflows;
+}
+
+size_t FixedPoint::scaleUnits(const vector<int64_t> &units, int64_t n,
+                              vector<int64_t> &result, vector<uint8_t> &overflow) {
+    result.resize(units.size());
+    overflow.resize(units.size());
+
+    return scaleUnits(units.data(), result.data(), overflow.data(), units.size(), n);
+}
\ No newline at end of file
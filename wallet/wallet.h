@@ -3,9 +3,54 @@
 
 #include <vector>
 #include <chrono>
+#include <cstdint>
+#include <string>
 #include <boost/operators.hpp>
 #include <iostream>
 
+/**
+ * Arytmetyka stałoprzecinkowa na "jednostkach" (1B = 1e8).
+ * Sprawdzanie przepełnienia opiera się na wbudowanych funkcjach kompilatora (__builtin_*_overflow),
+ * które na x86/ARM sprowadzają się do jednej instrukcji i odczytu flagi - bez dzielenia przed każdą operacją.
+ * Funkcje zwracają true gdy wynik NIE mieści się w int64_t (wtedy result jest niezdefiniowany).
+ */
+namespace FixedPoint {
+    constexpr int64_t UNITS_CONVERTER = 100'000'000;
+
+    constexpr bool subOverflow(int64_t a, int64_t b, int64_t &result) {
+        return __builtin_sub_overflow(a, b, &result);
+    }
+
+    constexpr bool mulOverflow(int64_t a, int64_t b, int64_t &result) {
+        return __builtin_mul_overflow(a, b, &result);
+    }
+
+    constexpr int64_t integerPart(int64_t units) {
+        return units / UNITS_CONVERTER;
+    }
+
+    constexpr int64_t fractionalPart(int64_t units) {
+        return units % UNITS_CONVERTER;
+    }
+
+    /**
+     * Wsadowe mnożenie wartości portfeli (w jednostkach) przez naturalne n.
+     * result[i] = units[i] * n, a overflow[i] = 1 jeśli iloczyn nie mieści się w int64_t (wtedy result[i] = 0).
+     * Granice przepełnienia liczone są raz na cały wsad, dzięki czemu pętla nie ma rozgałęzień
+     * ani dzielenia i kompilator może ją zwektoryzować.
+     * Tablice nie mogą na siebie nachodzić.
+     * Jeśli n jest ujemne, rzuca wyjątek invalid_argument.
+     * @return Liczba wartości, dla których wystąpiło przepełnienie.
+     */
+    size_t scaleUnits(const int64_t *units, int64_t *result, uint8_t *overflow, size_t size, int64_t n);
+
+    /**
+     * Jak wyżej, dla wektorów - wektory wynikowe dostosowują swój rozmiar do units.
+     */
+    size_t scaleUnits(const std::vector<int64_t> &units, int64_t n,
+                      std::vector<int64_t> &result, std::vector<uint8_t> &overflow);
+}
+
 class Wallet: boost::ordered_field_operators<Wallet> {
 public:
     class Operation: boost::ordered_field_operators<Operation> {
@@ -115,10 +160,16 @@ private:
      int64_t returnAllB();
 
     /**
-     * Sprawdza czy podane wartości pomnożone przez siebie nie przekroczą wartości INT64_MAX
-     * Jeśli przekroczą to rzuca wyjątek informujący o zbyt dużej wartości.
+     * Zwraca iloczyn podanych wartości.
+     * Jeśli iloczyn nie mieści się w int64_t to rzuca wyjątek informujący o zbyt dużej wartości.
+     */
+    static int64_t checkedMultiply(int64_t a, int64_t b);
+
+    /**
+     * Zwraca różnicę podanych wartości.
+     * Jeśli różnica nie mieści się w int64_t to rzuca wyjątek informujący o zbyt dużej wartości.
      */
-    static void multiplicationValidation(int64_t a, int64_t b);
+    static int64_t checkedSubtract(int64_t a, int64_t b);
 
     /**
     * Sprawdzaa czy podana wartość jest poprawna - większa niż MIN_WALLET_VALUE
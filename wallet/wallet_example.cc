@@ -0,0 +1,57 @@
+#include <cassert>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+#include "wallet.h"
+
+using std::vector;
+
+int main() {
+    // Iloczyny mieszczące się w int64_t, również ujemne.
+    vector<int64_t> units = {0, 1, -3, 21'000'000 * FixedPoint::UNITS_CONVERTER, INT64_MAX / 7, INT64_MIN / 7};
+    vector<int64_t> result;
+    vector<uint8_t> overflow;
+    assert(FixedPoint::scaleUnits(units, 7, result, overflow) == 0);
+    assert((result == vector<int64_t>{0, 7, -21, 147'000'000 * FixedPoint::UNITS_CONVERTER,
+                                      INT64_MAX / 7 * 7, INT64_MIN / 7 * 7}));
+    assert((overflow == vector<uint8_t>(units.size(), 0)));
+
+    // Przepełnienie tuż za granicami, z obu stron - wynik jest wtedy zerowany.
+    units = {INT64_MAX / 2, INT64_MAX / 2 + 1, INT64_MIN / 2, INT64_MIN / 2 - 1, INT64_MAX, INT64_MIN, 5};
+    assert(FixedPoint::scaleUnits(units, 2, result, overflow) == 4);
+    assert((result == vector<int64_t>{INT64_MAX - 1, 0, INT64_MIN, 0, 0, 0, 10}));
+    assert((overflow == vector<uint8_t>{0, 1, 0, 1, 1, 1, 0}));
+
+    // Mnożenie przez 0 i 1 nigdy nie przepełnia.
+    assert(FixedPoint::scaleUnits(units, 0, result, overflow) == 0);
+    assert((result == vector<int64_t>(units.size(), 0)));
+    assert(FixedPoint::scaleUnits(units, 1, result, overflow) == 0);
+    assert(result == units);
+
+    // Duże n: przepełnia wszystko poza 0, 1 i -1.
+    units = {0, 1, -1, 2, -2};
+    assert(FixedPoint::scaleUnits(units, INT64_MAX, result, overflow) == 2);
+    assert((result == vector<int64_t>{0, INT64_MAX, -INT64_MAX, 0, 0}));
+    assert((overflow == vector<uint8_t>{0, 0, 0, 1, 1}));
+
+    // Wektory wynikowe dostosowują rozmiar do units, w tym do pustego wsadu.
+    units.clear();
+    assert(FixedPoint::scaleUnits(units, 3, result, overflow) == 0);
+    assert(result.empty() && overflow.empty());
+
+    // Wersja na tablicach zapisuje dokładnie size wartości.
+    const int64_t raw_units[] = {4, INT64_MAX / 3 + 1, -4};
+    int64_t raw_result[4] = {-1, -1, -1, -1};
+    uint8_t raw_overflow[4] = {9, 9, 9, 9};
+    assert(FixedPoint::scaleUnits(raw_units, raw_result, raw_overflow, 3, 3) == 1);
+    assert(raw_result[0] == 12 && raw_result[1] == 0 && raw_result[2] == -12 && raw_result[3] == -1);
+    assert(raw_overflow[0] == 0 && raw_overflow[1] == 1 && raw_overflow[2] == 0 && raw_overflow[3] == 9);
+
+    try {
+        FixedPoint::scaleUnits(units, -1, result, overflow);
+        assert(false);
+    } catch (const std::invalid_argument &) {
+    }
+
+    return 0;
+}